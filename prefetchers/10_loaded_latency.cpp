@@ -0,0 +1,322 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <x86intrin.h> // For _mm_pause
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "dram_alloc.h"
+#include "latency.h"
+#include "checksum.h"
+
+#define LATENCY_BYTES 512ULL * 1024 * 1024
+#define LATENCY_ACCESSES 2000000ULL
+#define LOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define LOAD_BLOCK_BYTES 4096
+
+// Idle time injected by each generator after every 4 KiB block, in ns.
+static const char *LOAD_DELAYS_NS = "0,100,250,500,1000,2000,4000,8000";
+
+struct load_generator_s
+{
+    int pu_id;
+    char *slice;
+    size_t size;
+    bool write;
+    uint64_t delay_ticks;
+    std::atomic<uint64_t> bytes; // Bytes moved so far
+};
+typedef struct load_generator_s load_generator_t;
+
+struct load_state_s
+{
+    hwloc_topology_t topology;
+    checksum_kernel_t checksum_read;
+    std::atomic<bool> stop;
+    std::atomic<int> ready; // Generators that finished their first pass
+    std::atomic<bool> unbound; // A generator could not be bound to its PU
+};
+typedef struct load_state_s load_state_t;
+
+void load_generator_run(load_state_t *state, load_generator_t *generator);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_nodes] [-g load_cpu_node] [-G load_mem_node] [-t threads] [-w] [-d delays_ns] [-l latency_bytes] [-a accesses] [-p load_bytes] [-o output_csv]\n"
+        "  -c  NUMA node running the latency probe (default: 0)\n"
+        "  -m  comma-separated memory nodes holding the probed buffer (default: all nodes)\n"
+        "  -g  NUMA node running the bandwidth generators (default: the probe node)\n"
+        "  -G  memory node the generators stream from or to (default: the probed memory node)\n"
+        "  -t  generator threads (default: every other core of the generator node)\n"
+        "  -w  generators write instead of read\n"
+        "  -d  comma-separated idle ns injected per 4 KiB block by each generator (default: %s)\n"
+        "  -l  latency buffer in bytes (default: 512 MiB)\n"
+        "  -a  dependent loads timed per point (default: 2000000)\n"
+        "  -p  generator buffer in bytes, split between the threads (default: 1 GiB)\n"
+        "  -o  also write every point to a CSV file\n",
+        program, LOAD_DELAYS_NS);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    std::string mem_nodes;
+    int load_cpu_numa_id = -1;
+    int load_mem_numa_id = -1;
+    int num_threads = 0;
+    bool load_write = false;
+    std::string delays = LOAD_DELAYS_NS;
+    size_t latency_bytes = LATENCY_BYTES;
+    size_t accesses = LATENCY_ACCESSES;
+    size_t load_bytes = LOAD_BYTES;
+    std::string output_csv;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:g:G:t:wd:l:a:p:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_nodes = optarg; break;
+            case 'g': load_cpu_numa_id = atoi(optarg); break;
+            case 'G': load_mem_numa_id = atoi(optarg); break;
+            case 't': num_threads = atoi(optarg); break;
+            case 'w': load_write = true; break;
+            case 'd': delays = optarg; break;
+            case 'l': latency_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': accesses = strtoull(optarg, NULL, 0); break;
+            case 'p': load_bytes = strtoull(optarg, NULL, 0); break;
+            case 'o': output_csv = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (load_cpu_numa_id < 0)
+        load_cpu_numa_id = cpu_numa_id;
+
+    std::vector<uint64_t> delays_ns;
+    std::istringstream iss(delays);
+    std::string token;
+    while (std::getline(iss, token, ','))
+        delays_ns.push_back(strtoull(token.c_str(), NULL, 0));
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    // The probe runs on the calling thread, on the first core of its node;
+    // generators take the other cores of their node.
+    std::vector<int> probe_pus = cpu_pus_get(topology, "", cpu_numa_id);
+    if (probe_pus.empty())
+    {
+        XBT_ERROR("NUMA node %d has no cores to run the latency probe.", cpu_numa_id);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+    thread_bind_to_pu(topology, probe_pus[0]);
+
+    std::vector<int> load_pus;
+    for (int pu : cpu_pus_get(topology, "", load_cpu_numa_id))
+        if (pu != probe_pus[0])
+            load_pus.push_back(pu);
+    if (load_pus.empty())
+    {
+        XBT_ERROR("NUMA node %d has no cores left for the load generators besides the probe.", load_cpu_numa_id);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+    if (num_threads > (int)load_pus.size())
+        XBT_WARN("NUMA node %d has %zu cores for the load generators, running %zu instead of %d.",
+            load_cpu_numa_id, load_pus.size(), load_pus.size(), num_threads);
+    if (num_threads > 0 && num_threads < (int)load_pus.size())
+        load_pus.resize(num_threads);
+
+    FILE *csv = NULL;
+    if (!output_csv.empty())
+    {
+        csv = fopen(output_csv.c_str(), "w");
+        if (!csv)
+        {
+            XBT_ERROR("unable to open %s. errno: %d, error: %s", output_csv.c_str(), errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(csv, "cpu_numa_id,mem_numa_id,load_cpu_numa_id,load_mem_numa_id,threads,delay_ns,load_gbps,latency_ns\n");
+    }
+
+    load_state_t state;
+    state.topology = topology;
+    state.checksum_read = checksum_kernel_get(isa_best());
+
+    for (int mem_numa_id : numa_ids_get(topology, mem_nodes))
+    {
+        int generator_numa_id = load_mem_numa_id >= 0 ? load_mem_numa_id : mem_numa_id;
+
+        // The probe chases over huge pages (see 7_pointer_chase.cpp), so its
+        // idle and loaded latencies do not include a DTLB miss per load.
+        dram_buffer_t latency_mapping = dram_buffer_alloc(topology, latency_bytes, DRAM_BACKEND_THP, mem_numa_id);
+        char *latency_buffer = latency_mapping.ptr;
+
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, generator_numa_id);
+        char *load_buffer = (char *)hwloc_alloc_membind(topology, load_bytes, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        hwloc_bitmap_free(nodeset);
+
+        if (!latency_buffer || !load_buffer)
+        {
+            XBT_ERROR("unable to create buffers on NUMA nodes %d and %d. errno: %d, error: %s", mem_numa_id, generator_numa_id, errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        memset(load_buffer, 1, load_bytes);
+
+        char *head = latency_chase_build(latency_buffer, latency_bytes, CACHE_LINE_SIZE);
+        latency_chase_run_ns(&head, latency_bytes / CACHE_LINE_SIZE);
+
+        dram_pages_t pages = dram_buffer_pages(latency_mapping);
+        if (pages.huge_bytes < latency_bytes / 2)
+            XBT_WARN("probe buffer on NUMA node %d is backed by 4 KiB pages, the latency includes TLB misses.", mem_numa_id);
+
+        // The first point is the idle latency, without generators.
+        std::vector<std::pair<size_t, uint64_t>> points = {{0, 0}};
+        for (uint64_t delay_ns : delays_ns)
+            points.push_back({load_pus.size(), delay_ns});
+
+        for (const auto &point : points)
+        {
+            size_t threads = point.first;
+            uint64_t delay_ns = point.second;
+
+            size_t slice_bytes = threads ? (load_bytes / threads) & ~((size_t)CACHE_LINE_SIZE - 1) : 0;
+            std::vector<load_generator_t> generators(threads);
+            for (size_t i = 0; i < threads; i++)
+            {
+                generators[i].pu_id = load_pus[i];
+                generators[i].slice = load_buffer + i * slice_bytes;
+                generators[i].size = slice_bytes;
+                generators[i].write = load_write;
+                generators[i].delay_ticks = (uint64_t)(delay_ns * timer_ticks_per_ns());
+                generators[i].bytes = 0;
+            }
+
+            state.stop = false;
+            state.ready = 0;
+            state.unbound = false;
+
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < threads; i++)
+                workers.emplace_back(load_generator_run, &state, &generators[i]);
+
+            // Probe only once every generator runs at its steady rate.
+            while (state.ready < (int)threads)
+                _mm_pause();
+
+            uint64_t bytes_start = 0;
+            for (const load_generator_t &generator : generators)
+                bytes_start += generator.bytes;
+            uint64_t start = timer_ticks();
+
+            double latency_ns = latency_chase_run_ns(&head, accesses);
+
+            uint64_t end = timer_ticks();
+            uint64_t bytes_end = 0;
+            for (const load_generator_t &generator : generators)
+                bytes_end += generator.bytes;
+
+            state.stop = true;
+            for (std::thread &worker : workers)
+                worker.join();
+
+            if (state.unbound)
+            {
+                XBT_ERROR("some generators could not be bound to the PUs of NUMA node %d.", load_cpu_numa_id);
+                dram_buffer_free(latency_mapping);
+                hwloc_free(topology, load_buffer, load_bytes);
+                if (csv)
+                    fclose(csv);
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+
+            double load_gbps = (bytes_end - bytes_start) / ((end - start) / timer_ticks_per_ns());
+
+            XBT_INFO("cpu_numa_id: %d, mem_numa_id: %d, load_cpu_numa_id: %d, load_mem_numa_id: %d, load: %s, threads: %zu, delay_ns: %lu, load_gbps: %f, latency_ns: %f, payload: %zu.",
+                cpu_numa_id, mem_numa_id, load_cpu_numa_id, generator_numa_id, load_write ? "write" : "read",
+                threads, delay_ns, load_gbps, latency_ns, latency_bytes);
+
+            if (csv)
+                fprintf(csv, "%d,%d,%d,%d,%zu,%lu,%f,%f\n", cpu_numa_id, mem_numa_id, load_cpu_numa_id, generator_numa_id,
+                    threads, delay_ns, load_gbps, latency_ns);
+        }
+
+        dram_buffer_free(latency_mapping);
+        hwloc_free(topology, load_buffer, load_bytes);
+    }
+
+    if (csv)
+        fclose(csv);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// Streams over the generator's slice in 4 KiB blocks until told to stop,
+// idling delay_ticks after every block to throttle its injection rate.
+void load_generator_run(load_state_t *state, load_generator_t *generator)
+{
+    // An unbound generator still runs so the probe does not wait for it.
+    if (!thread_try_bind_to_pu(state->topology, generator->pu_id))
+        state->unbound = true;
+
+    uint64_t checksum = 0;
+    bool first_pass = true;
+
+    while (!state->stop)
+    {
+        for (size_t offset = 0; offset < generator->size && !state->stop; offset += LOAD_BLOCK_BYTES)
+        {
+            size_t length = std::min((size_t)LOAD_BLOCK_BYTES, generator->size - offset);
+
+            if (generator->write)
+                memset(generator->slice + offset, (int)offset, length);
+            else
+                checksum += state->checksum_read(generator->slice + offset, length);
+
+            generator->bytes.store(generator->bytes.load(std::memory_order_relaxed) + length, std::memory_order_relaxed);
+
+            if (generator->delay_ticks)
+            {
+                uint64_t idle_start = timer_ticks();
+                while (timer_ticks() - idle_start < generator->delay_ticks)
+                    _mm_pause();
+            }
+        }
+
+        if (first_pass)
+        {
+            state->ready++;
+            first_pass = false;
+        }
+    }
+
+    // Keep the checksum alive so the reads are not optimized away.
+    volatile uint64_t sink = checksum;
+    (void)sink;
+}
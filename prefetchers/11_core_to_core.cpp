@@ -0,0 +1,238 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+
+#define ROUND_TRIPS 100000
+#define CACHE_LINE_SIZE 64
+
+// The line bounced between the two threads, alone in its cache line.
+struct alignas(CACHE_LINE_SIZE) ping_pong_line_s
+{
+    std::atomic<uint64_t> value;
+};
+typedef struct ping_pong_line_s ping_pong_line_t;
+
+std::vector<int> core_pus_get(hwloc_topology_t topology, const std::string &core_avail_mask, const std::string &scope);
+int pu_numa_id_get(hwloc_topology_t topology, int pu_id);
+double ping_pong_ns(hwloc_topology_t topology, int ping_pu, int pong_pu, size_t round_trips);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-k core_avail_mask] [-s scope] [-n round_trips] [-o output_dir]\n"
+        "  -k  cores to test, taskset format (default: every core)\n"
+        "  -s  core, l3 or node: test every core or one core per L3 or NUMA node (default: core)\n"
+        "  -n  round trips timed per pair (default: 100000)\n"
+        "  -o  directory receiving core_to_core_lat.txt and node_to_node_lat.txt (default: .)\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    std::string core_avail_mask;
+    std::string scope = "core";
+    size_t round_trips = ROUND_TRIPS;
+    std::string output_dir = ".";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:s:n:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'k': core_avail_mask = optarg; break;
+            case 's': scope = optarg; break;
+            case 'n': round_trips = strtoull(optarg, NULL, 0); break;
+            case 'o': output_dir = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (scope != "core" && scope != "l3" && scope != "node")
+    {
+        XBT_ERROR("unknown scope: %s (expected core, l3 or node)", scope.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> pus = core_pus_get(topology, core_avail_mask, scope);
+    size_t num_pus = pus.size();
+    int num_nodes = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+
+    std::vector<std::vector<double>> core_latency_ns(num_pus, std::vector<double>(num_pus, 0.0));
+    std::vector<std::vector<double>> node_latency_ns(num_nodes, std::vector<double>(num_nodes, 0.0));
+    std::vector<std::vector<size_t>> node_pairs(num_nodes, std::vector<size_t>(num_nodes, 0));
+
+    std::vector<int> node_index(num_pus);
+    for (size_t i = 0; i < num_pus; i++)
+        node_index[i] = hwloc_get_numanode_obj_by_os_index(topology, pu_numa_id_get(topology, pus[i]))->logical_index;
+
+    // Rows are the cores writing the line first (ping), columns the cores answering (pong).
+    for (size_t i = 0; i < num_pus; i++)
+    {
+        for (size_t j = 0; j < num_pus; j++)
+        {
+            if (i == j)
+                continue;
+
+            core_latency_ns[i][j] = ping_pong_ns(topology, pus[i], pus[j], round_trips);
+            if (core_latency_ns[i][j] < 0)
+            {
+                XBT_ERROR("unable to pin the ping-pong threads to PUs %d and %d.", pus[i], pus[j]);
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+            node_latency_ns[node_index[i]][node_index[j]] += core_latency_ns[i][j];
+            node_pairs[node_index[i]][node_index[j]]++;
+
+            XBT_INFO("ping_pu: %d, pong_pu: %d, ping_numa_id: %d, pong_numa_id: %d, round_trips: %zu, latency_ns: %f.",
+                pus[i], pus[j], pu_numa_id_get(topology, pus[i]), pu_numa_id_get(topology, pus[j]),
+                round_trips, core_latency_ns[i][j]);
+        }
+    }
+
+    // Node latency is the average over the tested core pairs of the two nodes.
+    for (int i = 0; i < num_nodes; i++)
+        for (int j = 0; j < num_nodes; j++)
+            if (node_pairs[i][j])
+                node_latency_ns[i][j] /= node_pairs[i][j];
+
+    XBT_INFO("cores: [%s], scope: %s.", join(pus).c_str(), scope.c_str());
+
+    matrix_write(output_dir + "/core_to_core_lat.txt", core_latency_ns, "%.1f");
+    matrix_write(output_dir + "/node_to_node_lat.txt", node_latency_ns, "%.1f");
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// First PU of every core in the mask (every core of the machine when empty),
+// or only the first of them in each L3 or NUMA node.
+std::vector<int> core_pus_get(hwloc_topology_t topology, const std::string &core_avail_mask, const std::string &scope)
+{
+    std::vector<int> pus;
+
+    if (core_avail_mask.empty())
+    {
+        hwloc_obj_t node = NULL;
+        while ((node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NUMANODE, node)) != NULL)
+            for (int pu : cpu_pus_get(topology, "", node->os_index))
+                pus.push_back(pu);
+    }
+    else
+        pus = cpu_pus_get(topology, core_avail_mask, -1);
+
+    if (scope == "core")
+        return pus;
+
+    hwloc_obj_type_t domain_type = scope == "l3" ? HWLOC_OBJ_L3CACHE : HWLOC_OBJ_NUMANODE;
+    std::vector<int> representatives;
+    std::vector<unsigned> domains_seen;
+
+    for (int pu : pus)
+    {
+        unsigned domain;
+        if (domain_type == HWLOC_OBJ_NUMANODE)
+            domain = pu_numa_id_get(topology, pu);
+        else
+        {
+            hwloc_obj_t l3 = hwloc_get_ancestor_obj_by_type(topology, domain_type, hwloc_get_pu_obj_by_os_index(topology, pu));
+            domain = l3 ? l3->logical_index : 0;
+        }
+
+        if (std::find(domains_seen.begin(), domains_seen.end(), domain) == domains_seen.end())
+        {
+            domains_seen.push_back(domain);
+            representatives.push_back(pu);
+        }
+    }
+
+    return representatives;
+}
+
+// OS index of the NUMA node whose cpuset holds the PU.
+int pu_numa_id_get(hwloc_topology_t topology, int pu_id)
+{
+    hwloc_obj_t node = NULL;
+    while ((node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NUMANODE, node)) != NULL)
+        if (hwloc_bitmap_isset(node->cpuset, pu_id))
+            return node->os_index;
+
+    return 0;
+}
+
+// Bounces one cache line between two pinned threads: ping writes odd values
+// and waits for the even answer of pong. Both spin without pause so the line
+// moves as soon as it is written. Returns the one-way transfer time, i.e.
+// half of the average round trip, or -1 if a thread could not be bound.
+double ping_pong_ns(hwloc_topology_t topology, int ping_pu, int pong_pu, size_t round_trips)
+{
+    ping_pong_line_t line;
+    line.value = 0;
+    // Unbound threads still finish the exchange so neither side spins forever.
+    std::atomic<bool> unbound(false);
+
+    std::thread pong([&]() {
+        if (!thread_try_bind_to_pu(topology, pong_pu))
+            unbound = true;
+        for (uint64_t expected = 1; expected < 2 * round_trips; expected += 2)
+        {
+            while (line.value.load(std::memory_order_acquire) != expected)
+                ;
+            line.value.store(expected + 1, std::memory_order_release);
+        }
+    });
+
+    double round_trip_ns = 0.0;
+    std::thread ping([&]() {
+        if (!thread_try_bind_to_pu(topology, ping_pu))
+            unbound = true;
+
+        // The first round trips warm up both cores and are not timed.
+        size_t warmup = std::min(round_trips / 10, (size_t)1000);
+        uint64_t value = 0;
+        uint64_t start = 0;
+
+        for (size_t trip = 0; trip < round_trips; trip++)
+        {
+            if (trip == warmup)
+                start = timer_ticks();
+
+            line.value.store(value + 1, std::memory_order_release);
+            while (line.value.load(std::memory_order_acquire) != value + 2)
+                ;
+            value += 2;
+        }
+
+        uint64_t end = timer_ticks();
+        round_trip_ns = (end - start) / timer_ticks_per_ns() / (round_trips - warmup);
+    });
+
+    ping.join();
+    pong.join();
+
+    if (unbound)
+        return -1.0;
+    return round_trip_ns / 2;
+}
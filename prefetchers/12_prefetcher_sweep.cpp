@@ -0,0 +1,239 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "dram_alloc.h"
+#include "latency.h"
+#include "checksum.h"
+#include "results.h"
+#include "msr.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define LATENCY_BYTES 256ULL * 1024 * 1024
+#define LATENCY_ACCESSES 2000000ULL
+#define PREFETCH_MASKS 16
+
+std::vector<int> core_siblings_get(hwloc_topology_t topology, int pu_id);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_nodes] [-k masks] [-B backend] [-p payload] [-l latency_bytes] [-a accesses] [-r repeats] [-o results]\n"
+        "  -c  NUMA node running the kernels (default: 0)\n"
+        "  -m  comma-separated memory nodes (default: all nodes)\n"
+        "  -k  comma-separated MSR 0x1A4 masks, bit set = disabled: [0]HW [1]ADJ [2]DCU [3]IP (default: 0 to 15)\n"
+        "  -B  MSR backend: dev (/dev/cpu/N/msr, needs root) or file:DIR (stand-in files) (default: dev)\n"
+        "  -p  bytes written and read per mask (default: 1 GiB)\n"
+        "  -l  latency buffer in bytes, 0 to skip the latency (default: 256 MiB)\n"
+        "  -a  dependent loads timed per mask (default: 2000000)\n"
+        "  -r  measured repetitions per mask (default: 1)\n"
+        "  -o  also write every record to a file (.csv for CSV, JSON lines otherwise)\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    std::string mem_nodes;
+    std::string masks_list;
+    std::string backend_spec = "dev";
+    size_t payload = PAYLOAD_BYTES;
+    size_t latency_bytes = LATENCY_BYTES;
+    size_t accesses = LATENCY_ACCESSES;
+    int repeats = 1;
+    std::string results_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:k:B:p:l:a:r:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_nodes = optarg; break;
+            case 'k': masks_list = optarg; break;
+            case 'B': backend_spec = optarg; break;
+            case 'p': payload = strtoull(optarg, NULL, 0); break;
+            case 'l': latency_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': accesses = strtoull(optarg, NULL, 0); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'o': results_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    std::vector<uint64_t> masks;
+    if (masks_list.empty())
+    {
+        for (uint64_t mask = 0; mask < PREFETCH_MASKS; mask++)
+            masks.push_back(mask);
+    }
+    else
+    {
+        std::istringstream iss(masks_list);
+        std::string token;
+        while (std::getline(iss, token, ','))
+            masks.push_back(strtoull(token.c_str(), NULL, 0) & MSR_PREFETCH_MASK);
+    }
+
+    msr_backend_t backend = msr_backend_parse(backend_spec);
+    results_file_t results = results_open(results_path);
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> pus = cpu_pus_get(topology, "", cpu_numa_id);
+    if (pus.empty())
+    {
+        XBT_ERROR("NUMA node %d has no cores to run the kernels.", cpu_numa_id);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+    thread_bind_to_pu(topology, pus[0]);
+
+    // MSR 0x1A4 is per core: change it on the benchmark PU and its siblings,
+    // leaving the rest of the node untouched.
+    std::vector<int> msr_pus = core_siblings_get(topology, pus[0]);
+
+    msr_prefetch_t msr;
+    if (!msr_prefetch_open(msr, backend, msr_pus))
+    {
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::string> saved;
+    for (uint64_t value : msr.saved)
+        saved.push_back(std::to_string(value & MSR_PREFETCH_MASK));
+    XBT_INFO("backend: %s, pus: [%s], saved_masks: [%s].", backend.name.c_str(), join(msr_pus).c_str(), join(saved).c_str());
+
+    checksum_kernel_t checksum_read = checksum_kernel_get(isa_best());
+
+    for (int mem_numa_id : numa_ids_get(topology, mem_nodes))
+    {
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, mem_numa_id);
+        char *buffer = (char *)hwloc_alloc_membind(topology, payload, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        hwloc_bitmap_free(nodeset);
+
+        // The chase runs over its own buffer on huge pages (see
+        // 7_pointer_chase.cpp), so latency_ns shows the prefetchers and not
+        // a DTLB miss per load.
+        dram_buffer_t chase = {NULL, 0, NULL, 0, DRAM_BACKEND_THP};
+        if (latency_bytes)
+            chase = dram_buffer_alloc(topology, latency_bytes, DRAM_BACKEND_THP, mem_numa_id);
+
+        if (!buffer || (latency_bytes && !chase.ptr))
+        {
+            XBT_ERROR("unable to create buffers on NUMA node %d. errno: %d, error: %s", mem_numa_id, errno, strerror(errno));
+            if (buffer)
+                hwloc_free(topology, buffer, payload);
+            dram_buffer_free(chase);
+            msr_prefetch_close(msr);
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        // Fault every page in once so no mask pays for page faults.
+        memset(buffer, 1, payload);
+        if (latency_bytes)
+        {
+            memset(chase.ptr, 1, latency_bytes);
+            dram_pages_t pages = dram_buffer_pages(chase);
+            if (pages.huge_bytes < latency_bytes / 2)
+                XBT_WARN("chase buffer on NUMA node %d is backed by 4 KiB pages, the latency includes TLB misses.", mem_numa_id);
+        }
+
+        for (uint64_t mask : masks)
+        {
+            if (!msr_prefetch_set(msr, mask))
+            {
+                hwloc_free(topology, buffer, payload);
+                dram_buffer_free(chase);
+                msr_prefetch_close(msr);
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+
+            std::vector<double> read_samples;
+            for (int iteration = 0; iteration < repeats; iteration++)
+            {
+                uint64_t start = timer_ticks();
+                memset(buffer, iteration, payload);
+                uint64_t end = timer_ticks();
+                double write_gbps = payload / ((end - start) / timer_ticks_per_ns());
+
+                start = timer_ticks();
+                volatile uint64_t checksum = checksum_read(buffer, payload);
+                end = timer_ticks();
+                (void)checksum;
+                double read_gbps = payload / ((end - start) / timer_ticks_per_ns());
+                read_samples.push_back(read_gbps);
+
+                double latency_ns = latency_bytes ? latency_chase_ns(chase.ptr, latency_bytes, accesses) : 0.0;
+
+                result_record_t record;
+                record_add(record, "cpu_numa_id", cpu_numa_id);
+                record_add(record, "mem_numa_id", mem_numa_id);
+                record_add(record, "mask", (long)mask);
+                record_add(record, "enabled", msr_prefetch_mask_str(mask));
+                record_add(record, "msr_masks", "[" + join(msr_prefetch_get(msr)) + "]");
+                record_add(record, "iteration", iteration);
+                record_add(record, "write_gbps", write_gbps);
+                record_add(record, "read_gbps", read_gbps);
+                record_add(record, "latency_ns", latency_ns);
+                record_add(record, "payload", payload);
+
+                XBT_INFO("%s", record_str(record).c_str());
+                results_write(results, record);
+            }
+
+            if (repeats > 1)
+                XBT_INFO("mem_numa_id: %d, mask: %lu, read_gbps: %s.", mem_numa_id, mask, repeat_stats_str(repeat_stats_get(read_samples)).c_str());
+        }
+
+        hwloc_free(topology, buffer, payload);
+        dram_buffer_free(chase);
+    }
+
+    msr_prefetch_close(msr);
+    results_close(results);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// OS indexes of every PU of the core holding pu_id (hyperthread siblings).
+std::vector<int> core_siblings_get(hwloc_topology_t topology, int pu_id)
+{
+    std::vector<int> pus;
+
+    hwloc_obj_t pu = hwloc_get_pu_obj_by_os_index(topology, pu_id);
+    hwloc_obj_t core = hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_CORE, pu);
+    if (!core)
+        return {pu_id};
+
+    int sibling;
+    hwloc_bitmap_foreach_begin(sibling, core->cpuset)
+    {
+        pus.push_back(sibling);
+    }
+    hwloc_bitmap_foreach_end();
+
+    return pus;
+}
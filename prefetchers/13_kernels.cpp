@@ -0,0 +1,268 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "dram_alloc.h"
+#include "results.h"
+#include "kernels.h"
+#include "evict.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+
+// The access patterns of 1_base_line.cpp to 4_streaming.cpp.
+struct kernel_preset_s
+{
+    const char *name;
+    kernel_config_t write;
+    kernel_config_t read;
+    bool flush_before_read; // Evict the whole buffer between the phases, untimed
+};
+typedef struct kernel_preset_s kernel_preset_t;
+
+static const kernel_preset_t KERNEL_PRESETS[] = {
+    // memset (vector stores), then the byte-by-byte checksum loop.
+    {"base_line", {32, KERNEL_TEMPORAL, 0, 4}, {1, KERNEL_TEMPORAL, 0, 1}, false},
+    // memset, flush every line, then a vector checksum with four accumulators.
+    {"flush_cache", {32, KERNEL_TEMPORAL, 0, 4}, {64, KERNEL_TEMPORAL, 0, 4}, true},
+    // _mm_stream_si64 stores, then one byte per line followed by its clflush.
+    {"streaming", {8, KERNEL_NON_TEMPORAL, 0, 1}, {1, KERNEL_FLUSH, 64, 1}, false},
+    // AVX-512 non-temporal stores and loads.
+    {"streaming-avx512", {64, KERNEL_NON_TEMPORAL, 0, 1}, {64, KERNEL_NON_TEMPORAL, 0, 1}, false},
+};
+
+const kernel_preset_t &kernel_preset_get(const std::string &name);
+bool list_has(const std::vector<std::string> &list, const std::string &value);
+kernel_bytes_t kernel_bytes_chunked(const kernel_config_t &config, size_t size, size_t chunk_bytes);
+void chunk_timing_touched(chunk_timing_t &timing, const kernel_config_t &config);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-P preset] [-w widths] [-t temporalities] [-s strides] [-u unrolls] [-F] [-M policy] [-p payload] [-o results] [-r repeats] [-W warmup]\n"
+        "  -P  run the kernels of base_line, flush_cache, streaming or streaming-avx512 instead of the matrix\n"
+        "  -w  comma-separated access widths in bytes: 1, 8, 16, 32, 64 (default: all)\n"
+        "  -t  comma-separated temporalities: temporal, nt, flush (default: all)\n"
+        "  -s  comma-separated strides in bytes, 0 for contiguous: 0, 64, 4096 (default: all)\n"
+        "  -u  comma-separated unroll factors: 1, 2, 4, 8 (default: all)\n"
+        "  -F  evict the buffer from the caches between the write and read phases (untimed, clflushopt if supported)\n"
+        "  -M  memory policy: default, bind:N[,N...], interleave:N[,N...] or first-touch:N (default: default)\n"
+        "  -p  buffer size in bytes (default: 1 GiB)\n"
+        "  -o  also write one JSON line per kernel and iteration to this file, or CSV if it ends in .csv\n"
+        "  -r  measured iterations per kernel (default: 1)\n"
+        "  -W  warm-up iterations per kernel, not reported (default: 0)\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    std::string preset_name;
+    std::vector<std::string> widths, temporalities, strides, unrolls;
+    bool flush_before_read = false;
+    mem_policy_t policy = {MEM_POLICY_DEFAULT, {}};
+    size_t payload_bytes = PAYLOAD_BYTES;
+    std::string results_path;
+    int repeats = 1;
+    int warmup = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "P:w:t:s:u:FM:p:o:r:W:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'P': preset_name = optarg; break;
+            case 'w': widths = list_split(optarg); break;
+            case 't': temporalities = list_split(optarg); break;
+            case 's': strides = list_split(optarg); break;
+            case 'u': unrolls = list_split(optarg); break;
+            case 'F': flush_before_read = true; break;
+            case 'M': policy = mem_policy_parse(optarg); break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'o': results_path = optarg; break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'W': warmup = atoi(optarg); break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    // Each run is a (write kernel, read kernel) pair: the preset's, or the
+    // same kernel for both phases for every selected matrix entry.
+    std::vector<std::pair<kernel_entry_t, kernel_entry_t>> runs;
+    if (!preset_name.empty())
+    {
+        const kernel_preset_t &preset = kernel_preset_get(preset_name);
+        runs.push_back({kernel_get(preset.write), kernel_get(preset.read)});
+        flush_before_read = preset.flush_before_read;
+    }
+    else
+    {
+        for (const kernel_entry_t &entry : kernel_matrix())
+        {
+            const kernel_config_t &config = entry.config;
+            if ((widths.empty() || list_has(widths, std::to_string(config.width))) &&
+                (temporalities.empty() || list_has(temporalities, kernel_temporality_name(config.temporality))) &&
+                (strides.empty() || list_has(strides, std::to_string(config.stride))) &&
+                (unrolls.empty() || list_has(unrolls, std::to_string(config.unroll))))
+                runs.push_back({entry, entry});
+        }
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    results_file_t results = results_open(results_path);
+
+    evict_t evict = evict_open(topology, evict_method_best());
+
+    dram_buffer_t dram_buffer = dram_buffer_alloc(topology, payload_bytes, DRAM_BACKEND_PAGES, policy);
+    char *buffer = dram_buffer.ptr;
+    if (!buffer)
+    {
+        XBT_ERROR("unable to create buffer. errno: %d, error: %s", errno, strerror(errno));
+        evict_close(evict);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    // Fault every page in once so the first kernel does not pay for it.
+    memset(buffer, 1, payload_bytes);
+
+    for (const auto &run : runs)
+    {
+        const kernel_entry_t &write_kernel = run.first;
+        const kernel_entry_t &read_kernel = run.second;
+        std::string write_name = kernel_config_str(write_kernel.config);
+        std::string read_name = kernel_config_str(read_kernel.config);
+
+        if (!isa_supported(write_kernel.isa) || !isa_supported(read_kernel.isa))
+        {
+            XBT_WARN("write_kernel: %s, read_kernel: %s, skipped: %s is not supported by this CPU.", write_name.c_str(), read_name.c_str(),
+                isa_name(isa_supported(write_kernel.isa) ? read_kernel.isa : write_kernel.isa));
+            continue;
+        }
+
+        // Strided and narrow kernels touch only part of the buffer; bandwidth is
+        // computed from the bytes they actually access, and from the lines.
+        kernel_bytes_t write_bytes = kernel_bytes_chunked(write_kernel.config, payload_bytes, CHUNK_BYTES);
+        kernel_bytes_t read_bytes = kernel_bytes_chunked(read_kernel.config, payload_bytes, CHUNK_BYTES);
+
+        std::vector<double> write_times_us, read_times_us;
+        for (int iteration = 0; iteration < warmup + repeats; iteration++)
+        {
+            uint64_t value = (uint64_t)(iteration + 1) * 0x0101010101010101ULL;
+            chunk_timing_t write_timing = chunk_timed_run(payload_bytes, CHUNK_BYTES,
+                [&](size_t offset, size_t length) { write_kernel.write(buffer + offset, length, value); });
+            chunk_timing_touched(write_timing, write_kernel.config);
+            chunk_stats_t write_stats = chunk_stats_get(write_timing);
+
+            if (flush_before_read)
+                evict_run(evict, buffer, payload_bytes);
+
+            uint64_t checksum = 0;
+            chunk_timing_t read_timing = chunk_timed_run(payload_bytes, CHUNK_BYTES,
+                [&](size_t offset, size_t length) { checksum += read_kernel.read(buffer + offset, length); });
+            chunk_timing_touched(read_timing, read_kernel.config);
+            chunk_stats_t read_stats = chunk_stats_get(read_timing);
+
+            if (iteration < warmup)
+                continue;
+
+            write_times_us.push_back(write_stats.time_us);
+            read_times_us.push_back(read_stats.time_us);
+
+            result_record_t record;
+            record_add(record, "write_kernel", write_name);
+            record_add(record, "read_kernel", read_name);
+            record_add(record, "checksum", (size_t)checksum);
+            record_add(record, "write_time_us", write_stats.time_us);
+            record_add(record, "read_time_us", read_stats.time_us);
+            record_add(record, "write_touched_bytes", write_bytes.touched);
+            record_add(record, "write_line_bytes", write_bytes.lines);
+            record_add(record, "read_touched_bytes", read_bytes.touched);
+            record_add(record, "read_line_bytes", read_bytes.lines);
+            record_add(record, "write_gbps", write_bytes.touched / (write_stats.time_us * 1e3));
+            record_add(record, "read_gbps", read_bytes.touched / (read_stats.time_us * 1e3));
+            record_add(record, "write_line_gbps", write_bytes.lines / (write_stats.time_us * 1e3));
+            record_add(record, "read_line_gbps", read_bytes.lines / (read_stats.time_us * 1e3));
+            record_add(record, "write_chunk_gbps", chunk_stats_str(write_stats));
+            record_add(record, "read_chunk_gbps", chunk_stats_str(read_stats));
+            record_add(record, "flush", flush_before_read ? "yes" : "no");
+            record_add(record, "policy", mem_policy_str(policy));
+            record_add(record, "iteration", iteration - warmup);
+            record_add(record, "payload", payload_bytes);
+
+            XBT_INFO("%s", record_str(record).c_str());
+            results_write(results, record);
+        }
+
+        if (repeats > 1)
+            XBT_INFO("write_kernel: %s, read_kernel: %s, write_time_us: %s, read_time_us: %s, repeats: %d, warmup: %d.",
+                write_name.c_str(), read_name.c_str(),
+                repeat_stats_str(repeat_stats_get(write_times_us)).c_str(),
+                repeat_stats_str(repeat_stats_get(read_times_us)).c_str(),
+                repeats, warmup);
+    }
+
+    results_close(results);
+
+    dram_buffer_free(dram_buffer);
+    evict_close(evict);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+const kernel_preset_t &kernel_preset_get(const std::string &name)
+{
+    for (const kernel_preset_t &preset : KERNEL_PRESETS)
+        if (name == preset.name)
+            return preset;
+
+    XBT_ERROR("unknown preset: %s (expected base_line, flush_cache, streaming or streaming-avx512)", name.c_str());
+    throw std::runtime_error("unknown preset.");
+}
+
+bool list_has(const std::vector<std::string> &list, const std::string &value)
+{
+    for (const std::string &item : list)
+        if (item == value)
+            return true;
+    return false;
+}
+
+// The kernels run once per chunk of chunk_bytes (see chunk_timed_run).
+kernel_bytes_t kernel_bytes_chunked(const kernel_config_t &config, size_t size, size_t chunk_bytes)
+{
+    kernel_bytes_t total = {0, 0};
+    for (size_t offset = 0; offset < size; offset += chunk_bytes)
+    {
+        kernel_bytes_t bytes = kernel_bytes_get(config, std::min(chunk_bytes, size - offset));
+        total.touched += bytes.touched;
+        total.lines += bytes.lines;
+    }
+    return total;
+}
+
+// Replaces the chunk sizes with the bytes the kernel touched in each chunk, so
+// the per-chunk throughput matches write_gbps/read_gbps.
+void chunk_timing_touched(chunk_timing_t &timing, const kernel_config_t &config)
+{
+    for (size_t &bytes : timing.bytes)
+        bytes = kernel_bytes_get(config, bytes).touched;
+}
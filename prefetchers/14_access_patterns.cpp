@@ -0,0 +1,241 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "isa.h"
+#include "results.h"
+#include "access.h"
+#include "evict.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define REPEATS 3
+#define ACCESS_VALUE 0x0202020202020202ULL
+
+static const char *ACCESS_PATTERNS = "strided,random,gather";
+static const char *ACCESS_STRIDES = "64,128,256,512,1024,2048,4096,8192";
+
+struct access_point_s
+{
+    std::string pattern;
+    size_t stride;      // 0 for random and gather
+    size_t lines;       // Lines touched per pass
+    double write_ns;    // Per line, best pass
+    double read_ns;
+};
+typedef struct access_point_s access_point_t;
+
+double best_ns(int repeats, size_t lines, const std::function<void()> &before, const std::function<void()> &pass);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_nodes] [-P patterns] [-s strides] [-p payload_bytes] [-a accesses] [-r repeats] [-o results]\n"
+        "  -c  NUMA node running the kernels (default: 0)\n"
+        "  -m  comma-separated memory nodes holding the buffer (default: all nodes)\n"
+        "  -P  comma-separated patterns: strided, random, gather (default: %s)\n"
+        "  -s  comma-separated strides in bytes for the strided pattern (default: %s)\n"
+        "  -p  buffer size in bytes per memory node (default: 1 GiB)\n"
+        "  -a  random lines per pass (default: one per line of the buffer)\n"
+        "  -r  passes per point, the fastest one is kept (default: 3)\n"
+        "  -o  also write every point to this file (.csv for CSV, JSON lines otherwise)\n",
+        program, ACCESS_PATTERNS, ACCESS_STRIDES);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    std::string mem_nodes;
+    std::string patterns = ACCESS_PATTERNS;
+    std::string strides = ACCESS_STRIDES;
+    size_t payload_bytes = PAYLOAD_BYTES;
+    size_t accesses = 0;
+    int repeats = REPEATS;
+    std::string results_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:P:s:p:a:r:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_nodes = optarg; break;
+            case 'P': patterns = optarg; break;
+            case 's': strides = optarg; break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': accesses = strtoull(optarg, NULL, 0); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'o': results_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    // Reject a mistyped pattern before faulting in the buffer.
+    for (const std::string &pattern : list_split(patterns))
+    {
+        if (pattern != "strided" && pattern != "random" && pattern != "gather")
+        {
+            XBT_ERROR("unknown pattern: %s (expected strided, random or gather)", pattern.c_str());
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (accesses == 0)
+        accesses = payload_bytes / CACHE_LINE_SIZE;
+    accesses = accesses / ACCESS_WORDS_PER_LINE * ACCESS_WORDS_PER_LINE; // Whole gathers
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> pus = cpu_pus_get(topology, "", cpu_numa_id);
+    if (pus.empty())
+    {
+        XBT_ERROR("NUMA node %d has no cores to run the kernels.", cpu_numa_id);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+    thread_bind_to_pu(topology, pus[0]);
+
+    results_file_t results = results_open(results_path);
+
+    // The index array is first touched here, on the CPU node, so only the
+    // data buffer is remote.
+    std::vector<uint64_t> offsets = access_offsets_random(payload_bytes, accesses);
+    bool gather_supported = isa_supported(ISA_AVX512);
+    evict_t evict = evict_open(topology, evict_method_best());
+
+    for (int mem_numa_id : numa_ids_get(topology, mem_nodes))
+    {
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, mem_numa_id);
+        char *buffer = (char *)hwloc_alloc_membind(topology, payload_bytes, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        hwloc_bitmap_free(nodeset);
+
+        if (!buffer)
+        {
+            XBT_ERROR("unable to create buffer on NUMA node %d. errno: %d, error: %s", mem_numa_id, errno, strerror(errno));
+            results_close(results);
+            evict_close(evict);
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        // Fault every page in once so no pattern pays for page faults.
+        memset(buffer, 1, payload_bytes);
+        std::vector<int> nlaw = thread_numa_get(topology, buffer, payload_bytes);
+        const char *locality = mem_numa_id == cpu_numa_id ? "local" : "remote";
+
+        // Every pass starts with the buffer out of the caches; otherwise the
+        // lines of large strides or of the previous pass hit in the LLC.
+        auto evict_buffer = [&]() { evict_run(evict, buffer, payload_bytes); };
+
+        std::vector<access_point_t> points;
+        for (const std::string &pattern : list_split(patterns))
+        {
+            uint64_t checksum = 0;
+
+            if (pattern == "strided")
+            {
+                for (const std::string &token : list_split(strides))
+                {
+                    size_t stride = std::max((size_t)CACHE_LINE_SIZE, (size_t)strtoull(token.c_str(), NULL, 0));
+                    size_t lines = (payload_bytes - CACHE_LINE_SIZE) / stride + 1;
+                    access_point_t point = {pattern, stride, lines, 0.0, 0.0};
+                    point.write_ns = best_ns(repeats, lines, evict_buffer, [&]() { access_write_strided(buffer, payload_bytes, stride, ACCESS_VALUE); });
+                    point.read_ns = best_ns(repeats, lines, evict_buffer, [&]() { checksum += access_read_strided(buffer, payload_bytes, stride, &lines); });
+                    points.push_back(point);
+                }
+            }
+            else if (pattern == "random")
+            {
+                access_point_t point = {pattern, 0, accesses, 0.0, 0.0};
+                point.write_ns = best_ns(repeats, accesses, evict_buffer, [&]() { access_write_random(buffer, offsets.data(), accesses, ACCESS_VALUE); });
+                point.read_ns = best_ns(repeats, accesses, evict_buffer, [&]() { checksum += access_read_random(buffer, offsets.data(), accesses); });
+                points.push_back(point);
+            }
+            else // gather
+            {
+                if (!gather_supported)
+                {
+                    XBT_WARN("gather needs AVX-512, skipping.");
+                    continue;
+                }
+                access_point_t point = {pattern, 0, accesses, 0.0, 0.0};
+                point.write_ns = best_ns(repeats, accesses, evict_buffer, [&]() { access_write_scatter(buffer, offsets.data(), accesses, ACCESS_VALUE); });
+                point.read_ns = best_ns(repeats, accesses, evict_buffer, [&]() { checksum += access_read_gather(buffer, offsets.data(), accesses); });
+                points.push_back(point);
+            }
+
+            // Keep the checksum alive so the reads are not optimized away.
+            volatile uint64_t sink = checksum;
+            (void)sink;
+        }
+
+        for (const access_point_t &point : points)
+        {
+            // Every access touches one line, so lines per ns * 64 is the rate
+            // at which lines come from (or go to) memory.
+            result_record_t record;
+            record_add(record, "cpu_numa_id", cpu_numa_id);
+            record_add(record, "mem_numa_id", mem_numa_id);
+            record_add(record, "locality", locality);
+            record_add(record, "numa_write", "[" + join(nlaw) + "]");
+            record_add(record, "pattern", point.pattern);
+            record_add(record, "stride", point.stride);
+            record_add(record, "lines", point.lines);
+            record_add(record, "write_ns", point.write_ns);
+            record_add(record, "read_ns", point.read_ns);
+            record_add(record, "write_gbps", CACHE_LINE_SIZE / point.write_ns);
+            record_add(record, "read_gbps", CACHE_LINE_SIZE / point.read_ns);
+            record_add(record, "evict", evict_str(evict));
+            record_add(record, "payload", payload_bytes);
+
+            XBT_INFO("%s", record_str(record).c_str());
+            results_write(results, record);
+        }
+
+        hwloc_free(topology, buffer, payload_bytes);
+    }
+
+    results_close(results);
+
+    evict_close(evict);
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// Fastest of `repeats` runs of pass, in ns per line. before runs ahead of
+// every pass, untimed.
+double best_ns(int repeats, size_t lines, const std::function<void()> &before, const std::function<void()> &pass)
+{
+    double best = 0.0;
+    for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+    {
+        before();
+
+        uint64_t start = timer_ticks();
+        pass();
+        uint64_t end = timer_ticks();
+
+        double ns = (end - start) / timer_ticks_per_ns() / std::max(lines, (size_t)1);
+        if (repeat == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
@@ -0,0 +1,237 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "results.h"
+#include "copy.h"
+#include "evict.h"
+
+#define REPEATS 5
+#define COPY_THREADS 4
+
+// Output sizes of the workflow edges, 4e7 to 1e8 bytes.
+static const char *COPY_SIZES = "40000000,60000000,80000000,100000000";
+static const char *COPY_STRATEGY_LIST = "memcpy,rep-movsb,avx512-nt,threaded";
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m nodes] [-s sizes] [-S strategies] [-t threads] [-r repeats] [-o results]\n"
+        "  -c  NUMA node running the copies (default: the destination node of each pair)\n"
+        "  -m  comma-separated NUMA nodes used as sources and destinations (default: all nodes)\n"
+        "  -s  comma-separated copy sizes in bytes (default: %s)\n"
+        "  -S  comma-separated strategies: memcpy, rep-movsb, avx512-nt, threaded (default: all)\n"
+        "  -t  threads of the threaded strategy (default: %d, at most the PUs of the CPU node)\n"
+        "  -r  copies per point, the fastest one is kept (default: %d)\n"
+        "  -o  also write every point to this file (.csv for CSV, JSON lines otherwise)\n",
+        program, COPY_SIZES, COPY_THREADS, REPEATS);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = -1;
+    std::string nodes;
+    std::string sizes = COPY_SIZES;
+    std::string strategies = COPY_STRATEGY_LIST;
+    int threads = COPY_THREADS;
+    int repeats = REPEATS;
+    std::string results_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:s:S:t:r:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': nodes = optarg; break;
+            case 's': sizes = optarg; break;
+            case 'S': strategies = optarg; break;
+            case 't': threads = atoi(optarg); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'o': results_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    std::vector<size_t> copy_sizes;
+    for (const std::string &token : list_split(sizes))
+    {
+        size_t size = (size_t)strtod(token.c_str(), NULL); // Accepts 4e7
+        if (size == 0)
+        {
+            XBT_ERROR("invalid copy size: '%s' (expected a positive number of bytes)", token.c_str());
+            usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        copy_sizes.push_back(size);
+    }
+    if (copy_sizes.empty())
+    {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    size_t max_size = *std::max_element(copy_sizes.begin(), copy_sizes.end());
+
+    std::vector<copy_strategy_t> copy_strategies;
+    for (const std::string &token : list_split(strategies))
+    {
+        copy_strategy_t strategy = copy_strategy_parse(token);
+        if (!copy_strategy_supported(strategy))
+        {
+            XBT_WARN("%s is not supported by this CPU, skipping.", copy_strategy_name(strategy));
+            continue;
+        }
+        copy_strategies.push_back(strategy);
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> numa_ids = numa_ids_get(topology, nodes);
+
+    // One source and one destination buffer per node, so every pair (the
+    // diagonal included) copies between two distinct buffers.
+    std::vector<char *> sources, destinations;
+    for (int numa_id : numa_ids)
+    {
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, numa_id);
+        char *source = (char *)hwloc_alloc_membind(topology, max_size, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        char *destination = (char *)hwloc_alloc_membind(topology, max_size, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        hwloc_bitmap_free(nodeset);
+
+        if (!source || !destination)
+        {
+            XBT_ERROR("unable to create buffers on NUMA node %d. errno: %d, error: %s", numa_id, errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        // Fault every page in once so no copy pays for page faults.
+        memset(source, numa_id + 1, max_size);
+        memset(destination, 0, max_size);
+        sources.push_back(source);
+        destinations.push_back(destination);
+    }
+
+    results_file_t results = results_open(results_path);
+
+    // Both buffers are flushed before every timed copy, so each copy reads its
+    // source from and writes its destination to memory, not to the LLC that
+    // the previous copy or the verification left them in.
+    evict_t evict = evict_open(topology, evict_method_best());
+
+    for (size_t s = 0; s < numa_ids.size(); s++)
+    {
+        for (size_t d = 0; d < numa_ids.size(); d++)
+        {
+            int src_numa_id = numa_ids[s];
+            int dst_numa_id = numa_ids[d];
+            int run_numa_id = cpu_numa_id >= 0 ? cpu_numa_id : dst_numa_id;
+
+            std::vector<int> pus = cpu_pus_get(topology, "", run_numa_id);
+            if (pus.empty())
+            {
+                XBT_WARN("NUMA node %d has no cores to run the copies, skipping %d -> %d.", run_numa_id, src_numa_id, dst_numa_id);
+                continue;
+            }
+            thread_bind_to_pu(topology, pus[0]);
+            pus.resize(std::min(pus.size(), (size_t)std::max(threads, 1)));
+
+            for (size_t size : copy_sizes)
+            {
+                std::vector<double> times_us;
+                for (copy_strategy_t strategy : copy_strategies)
+                {
+                    copy_engine_t engine = {strategy, topology, pus};
+                    memset(destinations[d], 0, size);
+
+                    double best_us = 0.0;
+                    for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+                    {
+                        evict_run(evict, sources[s], size);
+                        evict_run(evict, destinations[d], size);
+
+                        uint64_t start = timer_ticks();
+                        bool bound = copy_run(engine, destinations[d], sources[s], size);
+                        uint64_t end = timer_ticks();
+
+                        if (!bound)
+                        {
+                            XBT_ERROR("%s copy %d -> %d could not bind its threads.", copy_strategy_name(strategy), src_numa_id, dst_numa_id);
+                            results_close(results);
+                            evict_close(evict);
+                            for (size_t i = 0; i < numa_ids.size(); i++)
+                            {
+                                hwloc_free(topology, sources[i], max_size);
+                                hwloc_free(topology, destinations[i], max_size);
+                            }
+                            hwloc_topology_destroy(topology);
+                            exit(EXIT_FAILURE);
+                        }
+
+                        double time_us = (end - start) / timer_ticks_per_ns() / 1e3;
+                        if (repeat == 0 || time_us < best_us)
+                            best_us = time_us;
+                    }
+                    times_us.push_back(best_us);
+
+                    bool verified = memcmp(destinations[d], sources[s], size) == 0;
+                    if (!verified)
+                        XBT_WARN("%s copy %d -> %d of %zu bytes does not match its source.", copy_strategy_name(strategy), src_numa_id, dst_numa_id, size);
+
+                    result_record_t record;
+                    record_add(record, "src_numa_id", src_numa_id);
+                    record_add(record, "dst_numa_id", dst_numa_id);
+                    record_add(record, "cpu_numa_id", run_numa_id);
+                    record_add(record, "strategy", copy_strategy_name(strategy));
+                    record_add(record, "threads", strategy == COPY_THREADED ? pus.size() : (size_t)1);
+                    record_add(record, "time_us", best_us);
+                    record_add(record, "gbps", size / (best_us * 1e3));
+                    record_add(record, "verified", verified ? "yes" : "no");
+                    record_add(record, "evict", evict_str(evict));
+                    record_add(record, "payload", size);
+
+                    XBT_INFO("%s", record_str(record).c_str());
+                    results_write(results, record);
+                }
+
+                if (times_us.empty())
+                    continue;
+
+                // The strategy to use for this size class and node pair.
+                size_t best = std::min_element(times_us.begin(), times_us.end()) - times_us.begin();
+                XBT_INFO("src_numa_id: %d, dst_numa_id: %d, best_strategy: %s, gbps: %.3f, payload: %zu.",
+                    src_numa_id, dst_numa_id, copy_strategy_name(copy_strategies[best]), size / (times_us[best] * 1e3), size);
+            }
+        }
+    }
+
+    results_close(results);
+    evict_close(evict);
+
+    for (size_t i = 0; i < numa_ids.size(); i++)
+    {
+        hwloc_free(topology, sources[i], max_size);
+        hwloc_free(topology, destinations[i], max_size);
+    }
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "isa.h"
+#include "checksum.h"
+#include "results.h"
+#include "copy.h"
+#include "staging.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define REPEATS 3
+
+static const char *STAGING_CHUNKS = "65536,262144,1048576,4194304";
+static const char *STAGING_DEPTHS = "2,4,8";
+
+char *node_buffer_alloc(hwloc_topology_t topology, int numa_id, size_t size);
+void staging_log(results_file_t &results, const char *mode, int cpu_numa_id, int mem_numa_id, size_t chunk_bytes, size_t depth,
+    const staging_result_t &result, uint64_t expected, const char *copy, size_t payload_bytes);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_nodes] [-k chunks] [-d depths] [-S copy] [-i isa] [-p payload_bytes] [-r repeats] [-o results]\n"
+        "  -c  NUMA node running the compute and copy threads, holding the ring (default: 0)\n"
+        "  -m  comma-separated nodes holding the input (default: every other node, or -c if there is none)\n"
+        "  -k  comma-separated chunk sizes in bytes (default: %s)\n"
+        "  -d  comma-separated ring depths in chunks (default: %s)\n"
+        "  -S  copy strategy of the helper thread: memcpy, rep-movsb or avx512-nt (default: memcpy)\n"
+        "  -i  checksum instruction set: scalar, sse, avx2 or avx512 (default: widest supported)\n"
+        "  -p  input size in bytes (default: 1 GiB)\n"
+        "  -r  runs per point, the fastest one is kept (default: %d)\n"
+        "  -o  also write every point to this file (.csv for CSV, JSON lines otherwise)\n",
+        program, STAGING_CHUNKS, STAGING_DEPTHS, REPEATS);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    std::string mem_nodes;
+    std::string chunks = STAGING_CHUNKS;
+    std::string depths = STAGING_DEPTHS;
+    copy_strategy_t copy_strategy = COPY_MEMCPY;
+    isa_t isa = isa_best();
+    size_t payload_bytes = PAYLOAD_BYTES;
+    int repeats = REPEATS;
+    std::string results_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:k:d:S:i:p:r:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_nodes = optarg; break;
+            case 'k': chunks = optarg; break;
+            case 'd': depths = optarg; break;
+            case 'S': copy_strategy = copy_strategy_parse(optarg); break;
+            case 'i': isa = isa_parse(optarg); break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'o': results_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (copy_strategy == COPY_THREADED)
+    {
+        XBT_ERROR("the helper thread copies one chunk at a time, threaded is not a valid strategy here.");
+        exit(EXIT_FAILURE);
+    }
+    if (!isa_supported(isa) || !copy_strategy_supported(copy_strategy))
+    {
+        XBT_ERROR("%s is not supported by this CPU.", isa_supported(isa) ? copy_strategy_name(copy_strategy) : isa_name(isa));
+        exit(EXIT_FAILURE);
+    }
+    checksum_kernel_t checksum_read = checksum_kernel_get(isa);
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> pus = cpu_pus_get(topology, "", cpu_numa_id);
+    if (pus.empty())
+    {
+        XBT_ERROR("NUMA node %d has no cores to run the pipeline.", cpu_numa_id);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+    int compute_pu = pus[0];
+    int copy_pu = pus.size() > 1 ? pus[1] : pus[0];
+    if (copy_pu == compute_pu)
+        XBT_WARN("NUMA node %d has a single PU, the copy and compute threads will share it.", cpu_numa_id);
+    thread_bind_to_pu(topology, compute_pu);
+
+    std::vector<int> mem_numa_ids;
+    for (int numa_id : numa_ids_get(topology, mem_nodes))
+        if (!mem_nodes.empty() || numa_id != cpu_numa_id)
+            mem_numa_ids.push_back(numa_id);
+    if (mem_numa_ids.empty())
+    {
+        XBT_WARN("no node other than %d, staging from the local node.", cpu_numa_id);
+        mem_numa_ids.push_back(cpu_numa_id);
+    }
+
+    // The local baseline reads a copy of the input already on the CPU node.
+    char *local = node_buffer_alloc(topology, cpu_numa_id, payload_bytes);
+    if (!local)
+    {
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    results_file_t results = results_open(results_path);
+    const char *copy = copy_strategy_name(copy_strategy);
+    copy_engine_t engine = {copy_strategy, topology, {}};
+
+    // Direct reads: the whole input, chunk by chunk, on the compute thread.
+    auto direct_run = [&](const char *input) {
+        staging_result_t best = {0.0, 0.0, 0.0, 0, true};
+        for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+        {
+            uint64_t start = timer_ticks();
+            uint64_t checksum = checksum_read(input, payload_bytes);
+            uint64_t end = timer_ticks();
+
+            double time_us = (end - start) / timer_ticks_per_ns() / 1e3;
+            if (repeat == 0 || time_us < best.time_us)
+                best = {time_us, 0.0, 0.0, checksum, true};
+        }
+        return best;
+    };
+
+    for (int mem_numa_id : mem_numa_ids)
+    {
+        char *input = node_buffer_alloc(topology, mem_numa_id, payload_bytes);
+        if (!input)
+            break;
+
+        for (size_t i = 0; i < payload_bytes; i++)
+            input[i] = (char)(i * 131 + mem_numa_id);
+        memcpy(local, input, payload_bytes);
+        uint64_t expected = checksum_read_scalar(input, payload_bytes);
+
+        staging_log(results, "local", cpu_numa_id, cpu_numa_id, 0, 0, direct_run(local), expected, "none", payload_bytes);
+        staging_log(results, "remote", cpu_numa_id, mem_numa_id, 0, 0, direct_run(input), expected, "none", payload_bytes);
+
+        for (const std::string &chunk_token : list_split(chunks))
+        {
+            size_t chunk_bytes = (size_t)strtod(chunk_token.c_str(), NULL);
+            for (const std::string &depth_token : list_split(depths))
+            {
+                size_t depth = std::max((size_t)2, (size_t)strtoull(depth_token.c_str(), NULL, 0));
+                char *ring = node_buffer_alloc(topology, cpu_numa_id, chunk_bytes * depth);
+                if (!ring)
+                    continue;
+                memset(ring, 0, chunk_bytes * depth);
+
+                staging_result_t best = {0.0, 0.0, 0.0, 0, true};
+                for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+                {
+                    staging_result_t result = staging_run(topology, input, payload_bytes, ring, chunk_bytes, depth,
+                        engine, checksum_read, copy_pu, compute_pu);
+                    if (!result.bound)
+                    {
+                        XBT_ERROR("the copy thread could not be bound to PU %d.", copy_pu);
+                        results_close(results);
+                        hwloc_free(topology, ring, chunk_bytes * depth);
+                        hwloc_free(topology, input, payload_bytes);
+                        hwloc_free(topology, local, payload_bytes);
+                        hwloc_topology_destroy(topology);
+                        exit(EXIT_FAILURE);
+                    }
+                    if (repeat == 0 || result.time_us < best.time_us)
+                        best = result;
+                }
+                staging_log(results, "staged", cpu_numa_id, mem_numa_id, chunk_bytes, depth, best, expected, copy, payload_bytes);
+
+                hwloc_free(topology, ring, chunk_bytes * depth);
+            }
+        }
+
+        hwloc_free(topology, input, payload_bytes);
+    }
+
+    results_close(results);
+
+    hwloc_free(topology, local, payload_bytes);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+char *node_buffer_alloc(hwloc_topology_t topology, int numa_id, size_t size)
+{
+    hwloc_nodeset_t nodeset = numa_nodeset_get(topology, numa_id);
+    char *buffer = (char *)hwloc_alloc_membind(topology, size, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+    hwloc_bitmap_free(nodeset);
+
+    if (!buffer)
+        XBT_ERROR("unable to create buffer on NUMA node %d. errno: %d, error: %s", numa_id, errno, strerror(errno));
+    return buffer;
+}
+
+// chunk and depth are 0 for the direct reads.
+void staging_log(results_file_t &results, const char *mode, int cpu_numa_id, int mem_numa_id, size_t chunk_bytes, size_t depth,
+    const staging_result_t &result, uint64_t expected, const char *copy, size_t payload_bytes)
+{
+    result_record_t record;
+    record_add(record, "mode", mode);
+    record_add(record, "cpu_numa_id", cpu_numa_id);
+    record_add(record, "mem_numa_id", mem_numa_id);
+    record_add(record, "chunk", chunk_bytes);
+    record_add(record, "depth", depth);
+    record_add(record, "copy", copy);
+    record_add(record, "time_us", result.time_us);
+    record_add(record, "gbps", payload_bytes / (result.time_us * 1e3));
+    record_add(record, "compute_stall_us", result.compute_stall_us);
+    record_add(record, "copy_stall_us", result.copy_stall_us);
+    record_add(record, "verified", result.checksum == expected ? "yes" : "no");
+    record_add(record, "payload", payload_bytes);
+
+    XBT_INFO("%s", record_str(record).c_str());
+    results_write(results, record);
+}
@@ -0,0 +1,294 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "isa.h"
+#include "checksum.h"
+#include "dram_alloc.h"
+#include "placement.h"
+#include "results.h"
+#include "migrate.h"
+
+#define PAYLOAD_BYTES 256ULL * 1024 * 1024
+#define REPEATS 3
+#define REUSE_MAX 8
+#define PAGE_SAMPLE 64
+
+static const char *MIGRATE_BACKENDS = "pages,thp";
+static const char *MIGRATE_METHODS = "move_pages,mbind";
+static const char *MIGRATE_BATCHES = "64,4096";
+static const char *MIGRATE_THREADS = "1,4";
+
+std::vector<double> reads_cumulative_us(checksum_kernel_t checksum_read, const char *buffer, size_t size, int reads, uint64_t *checksum);
+int break_even_measured(double migrate_us, const std::vector<double> &remote_us, const std::vector<double> &local_us);
+int break_even_estimate(double migrate_us, double remote_read_us, double local_read_us);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-m nodes] [-b backends] [-M methods] [-B batches] [-t threads] [-n reuse_max] [-p payload_bytes] [-r repeats] [-s page_sample] [-o results]\n"
+        "  -m  comma-separated NUMA nodes; every ordered pair (src, dst) is measured, the task running on dst (default: all nodes)\n"
+        "  -b  comma-separated allocation backends: pages, thp, hugetlb-2m or hugetlb-1g (default: %s)\n"
+        "  -M  comma-separated migration methods: move_pages, mbind (default: %s)\n"
+        "  -B  comma-separated pages per system call (default: %s)\n"
+        "  -t  comma-separated migration thread counts, at most the PUs of dst (default: %s)\n"
+        "  -n  reads of the input compared against one migration, 1..n (default: %d)\n"
+        "  -p  buffer size in bytes (default: 256 MiB)\n"
+        "  -r  migrations per point, the fastest one is kept (default: %d)\n"
+        "  -s  check the node of one page out of every page_sample pages after migrating (default: %d)\n"
+        "  -o  also write every point to this file (.csv for CSV, JSON lines otherwise)\n",
+        program, MIGRATE_BACKENDS, MIGRATE_METHODS, MIGRATE_BATCHES, MIGRATE_THREADS, REUSE_MAX, REPEATS, PAGE_SAMPLE);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    std::string nodes;
+    std::string backends = MIGRATE_BACKENDS;
+    std::string methods = MIGRATE_METHODS;
+    std::string batches = MIGRATE_BATCHES;
+    std::string thread_counts = MIGRATE_THREADS;
+    int reuse_max = REUSE_MAX;
+    size_t payload_bytes = PAYLOAD_BYTES;
+    int repeats = REPEATS;
+    size_t page_sample = PAGE_SAMPLE;
+    std::string results_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:b:M:B:t:n:p:r:s:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm': nodes = optarg; break;
+            case 'b': backends = optarg; break;
+            case 'M': methods = optarg; break;
+            case 'B': batches = optarg; break;
+            case 't': thread_counts = optarg; break;
+            case 'n': reuse_max = std::max(atoi(optarg), 1); break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 's': page_sample = strtoull(optarg, NULL, 0); break;
+            case 'o': results_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    checksum_kernel_t checksum_read = checksum_kernel_get(isa_best());
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> numa_ids = numa_ids_get(topology, nodes);
+    std::vector<std::pair<int, int>> pairs;
+    for (int src_numa_id : numa_ids)
+        for (int dst_numa_id : numa_ids)
+            if (src_numa_id != dst_numa_id)
+                pairs.push_back({src_numa_id, dst_numa_id});
+    if (pairs.empty())
+    {
+        XBT_WARN("fewer than two NUMA nodes, migrating within node %d.", numa_ids[0]);
+        pairs.push_back({numa_ids[0], numa_ids[0]});
+    }
+
+    results_file_t results = results_open(results_path);
+
+    for (const auto &pair : pairs)
+    {
+        int src_numa_id = pair.first;
+        int dst_numa_id = pair.second;
+
+        std::vector<int> pus = cpu_pus_get(topology, "", dst_numa_id);
+        if (pus.empty())
+        {
+            XBT_WARN("NUMA node %d has no cores to run the task, skipping %d -> %d.", dst_numa_id, src_numa_id, dst_numa_id);
+            continue;
+        }
+        thread_bind_to_pu(topology, pus[0]);
+
+        // Thread counts capped at the PUs of dst, without duplicates.
+        std::vector<size_t> threads_list;
+        for (const std::string &token : list_split(thread_counts))
+        {
+            size_t threads = std::min((size_t)std::max(atoi(token.c_str()), 1), pus.size());
+            if (std::find(threads_list.begin(), threads_list.end(), threads) == threads_list.end())
+                threads_list.push_back(threads);
+        }
+
+        for (const std::string &backend_name : list_split(backends))
+        {
+            dram_backend_t backend = dram_backend_parse(backend_name);
+            dram_buffer_t dram_buffer = dram_buffer_alloc(topology, payload_bytes, backend, src_numa_id);
+            char *buffer = dram_buffer.ptr;
+            if (!buffer)
+            {
+                XBT_WARN("unable to create a %s buffer on NUMA node %d, skipping.", backend_name.c_str(), src_numa_id);
+                continue;
+            }
+
+            memset(buffer, 1, payload_bytes);
+            dram_pages_t pages = dram_buffer_pages(dram_buffer);
+            size_t page_size = pages.huge_bytes >= payload_bytes / 2 ? std::max(pages.kernel_page_size, (size_t)PAGE_SIZE_2M) : PAGE_SIZE_4K;
+            if (backend != DRAM_BACKEND_PAGES && page_size == PAGE_SIZE_4K)
+                XBT_WARN("%s buffer is backed by 4 KiB pages.", backend_name.c_str());
+
+            // The task reading its input n times in place, then after moving it.
+            uint64_t checksum = 0;
+            std::vector<double> remote_us = reads_cumulative_us(checksum_read, buffer, payload_bytes, reuse_max, &checksum);
+            std::vector<double> local_us;
+
+            // Fastest configuration per pair and page size.
+            double best_migrate_us = 0.0;
+            std::string best_config;
+            int best_break_even = -1;
+
+            migrate_request_t back = {MIGRATE_MOVE_PAGES, page_size, 4096, {}};
+            bool on_src = true;
+
+            for (const std::string &method_name : list_split(methods))
+            {
+                migrate_method_t method = migrate_method_parse(method_name);
+                for (const std::string &batch_token : list_split(batches))
+                {
+                    size_t batch_pages = strtoull(batch_token.c_str(), NULL, 0);
+                    for (size_t threads : threads_list)
+                    {
+                        migrate_request_t request = {method, page_size, batch_pages, std::vector<int>(pus.begin(), pus.begin() + threads)};
+
+                        double migrate_us = 0.0;
+                        long pages_left = 0;
+                        for (int repeat = 0; repeat < std::max(repeats, 1); repeat++)
+                        {
+                            // Put the input back on the source node, untimed.
+                            if (!on_src && migrate_run(topology, buffer, payload_bytes, src_numa_id, back) != 0)
+                                XBT_WARN("some pages did not return to NUMA node %d.", src_numa_id);
+
+                            uint64_t start = timer_ticks();
+                            pages_left = migrate_run(topology, buffer, payload_bytes, dst_numa_id, request);
+                            uint64_t end = timer_ticks();
+                            on_src = false;
+
+                            if (pages_left < 0)
+                            {
+                                XBT_ERROR("%s migration %d -> %d failed.", migrate_method_name(method), src_numa_id, dst_numa_id);
+                                results_close(results);
+                                dram_buffer_free(dram_buffer);
+                                hwloc_topology_destroy(topology);
+                                exit(EXIT_FAILURE);
+                            }
+
+                            double time_us = (end - start) / timer_ticks_per_ns() / 1e3;
+                            if (repeat == 0 || time_us < migrate_us)
+                                migrate_us = time_us;
+                        }
+
+                        page_placement_t placement = page_placement_get(buffer, payload_bytes, page_sample, page_size);
+                        if (local_us.empty())
+                            local_us = reads_cumulative_us(checksum_read, buffer, payload_bytes, reuse_max, &checksum);
+
+                        double remote_read_us = remote_us.back() / reuse_max;
+                        double local_read_us = local_us.back() / reuse_max;
+                        int break_even = break_even_measured(migrate_us, remote_us, local_us);
+
+                        result_record_t record;
+                        record_add(record, "src_numa_id", src_numa_id);
+                        record_add(record, "dst_numa_id", dst_numa_id);
+                        record_add(record, "backend", dram_backend_name(backend));
+                        record_add(record, "page_size", page_size);
+                        record_add(record, "method", migrate_method_name(method));
+                        record_add(record, "threads", threads);
+                        record_add(record, "batch_pages", batch_pages);
+                        record_add(record, "migrate_us", migrate_us);
+                        record_add(record, "migrate_gbps", payload_bytes / (migrate_us * 1e3));
+                        record_add(record, "pages_left", pages_left);
+                        record_add(record, "pages_after", page_placement_str(placement));
+                        record_add(record, "remote_read_us", remote_read_us);
+                        record_add(record, "local_read_us", local_read_us);
+                        record_add(record, "break_even", break_even);
+                        record_add(record, "break_even_estimate", break_even_estimate(migrate_us, remote_read_us, local_read_us));
+                        record_add(record, "reuse_max", reuse_max);
+                        record_add(record, "payload", payload_bytes);
+
+                        XBT_INFO("%s", record_str(record).c_str());
+                        results_write(results, record);
+
+                        if (best_config.empty() || migrate_us < best_migrate_us)
+                        {
+                            best_migrate_us = migrate_us;
+                            best_config = std::string(migrate_method_name(method)) + "/t" + std::to_string(threads) + "/b" + std::to_string(batch_pages);
+                            best_break_even = break_even;
+                        }
+                    }
+                }
+            }
+
+            // Keep the checksum alive so the reads are not optimized away.
+            volatile uint64_t sink = checksum;
+            (void)sink;
+
+            if (!best_config.empty())
+                XBT_INFO("src_numa_id: %d, dst_numa_id: %d, page_size: %zu, best_migration: %s, migrate_us: %f, break_even: %d, payload: %zu.",
+                    src_numa_id, dst_numa_id, page_size, best_config.c_str(), best_migrate_us, best_break_even, payload_bytes);
+
+            dram_buffer_free(dram_buffer);
+        }
+    }
+
+    results_close(results);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// Time of the first 1..reads full reads of the buffer, element n-1 being
+// the total of the first n.
+std::vector<double> reads_cumulative_us(checksum_kernel_t checksum_read, const char *buffer, size_t size, int reads, uint64_t *checksum)
+{
+    std::vector<double> cumulative;
+    double total = 0.0;
+    for (int read = 0; read < reads; read++)
+    {
+        uint64_t start = timer_ticks();
+        *checksum += checksum_read(buffer, size);
+        uint64_t end = timer_ticks();
+
+        total += (end - start) / timer_ticks_per_ns() / 1e3;
+        cumulative.push_back(total);
+    }
+    return cumulative;
+}
+
+// Fewest reads n for which migrating then reading n times locally beats n
+// remote reads, or -1 if migrating does not pay within the measured reads.
+int break_even_measured(double migrate_us, const std::vector<double> &remote_us, const std::vector<double> &local_us)
+{
+    for (size_t n = 0; n < std::min(remote_us.size(), local_us.size()); n++)
+        if (migrate_us + local_us[n] <= remote_us[n])
+            return (int)n + 1;
+    return -1;
+}
+
+// Same from the mean read times, beyond the measured reads; -1 if remote
+// reads are not slower.
+int break_even_estimate(double migrate_us, double remote_read_us, double local_read_us)
+{
+    if (remote_read_us <= local_read_us)
+        return -1;
+    return (int)std::ceil(migrate_us / (remote_read_us - local_read_us));
+}
@@ -1,38 +1,93 @@
 #include <hwloc.h>
-#include <sys/time.h>
 #include <xbt/log.h>
 #include <vector>
 #include <sstream>
 #include <sys/resource.h> // For getrusage
 #include <fstream>
-#include <x86intrin.h> // For _mm_clflush
+#include <getopt.h>
+#include <x86intrin.h> // For _mm_mfence
 
 #define PAYLOAD_BYTES 4ULL * 1024 * 1024 * 1024
 #define CACHE_LINE_SIZE 64
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
 
-struct thread_locality_s
+#include "common.h"
+#include "timing.h"
+#include "perf_counters.h"
+#include "placement.h"
+#include "dram_alloc.h"
+#include "checksum.h"
+#include "results.h"
+#include "numa_sampler.h"
+#include "locality.h"
+#include "evict.h"
+
+void usage(const char *program)
 {
-    int numa_id;
-    int core_id;
-    long voluntary_context_switches;
-    long involuntary_context_switches;
-    long core_migrations;
-};
-typedef struct thread_locality_s thread_locality_t;
-
-double get_time_us();
-
-std::string join(const std::vector<int> &vec, const std::string &delimiter=",");
-std::vector<int> thread_numa_get(hwloc_topology_t topology, char *address, size_t size);
-thread_locality_t thread_get_locality_from_os(hwloc_topology_t topology);
+    fprintf(stderr,
+        "Usage: %s [-e evict] [-E batch_lines] [-M policy] [-i isa] [-o results] [-r repeats] [-s page_sample] [-t timeline] [-T interval_ms] [-W warmup]\n"
+        "  -e  eviction between the phases: clflush, clflushopt, clwb or thrash (default: clflushopt if supported)\n"
+        "  -E  lines flushed between two fences (default: 4096)\n"
+        "  -i  checksum kernel: scalar (byte loop), sse, avx2 or avx512 (default: widest supported)\n"
+        "  -M  memory policy: default, bind:N[,N...], interleave:N[,N...] or first-touch:N (default: default)\n"
+        "  -o  also write one JSON line per iteration to this file, or CSV if it ends in .csv\n"
+        "  -r  measured iterations of the write and read phases (default: 1)\n"
+        "  -s  query the NUMA node of one page out of every page_sample pages (default: 1, every page)\n"
+        "  -t  write the read-phase NUMA timeline to this file (JSON lines, or CSV if it ends in .csv)\n"
+        "  -T  sample /proc/vmstat and page placement every interval_ms during the read phase (default: 0, off)\n"
+        "  -W  warm-up iterations run before the measured ones, not reported (default: 0)\n",
+        program);
+}
 
 int main(int argc, char *argv[])
 {
     // Initialize XBT logging system
     xbt_log_init(&argc, argv);
 
+    isa_t isa = isa_best();
+    evict_method_t evict_method = evict_method_best();
+    size_t evict_batch = EVICT_BATCH_LINES;
+    mem_policy_t policy = {MEM_POLICY_DEFAULT, {}};
+    size_t page_sample = 1;
+    int repeats = 1;
+    int warmup = 0;
+    std::string results_path;
+    std::string timeline_path;
+    double sample_interval_ms = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "e:E:i:M:o:r:s:t:T:W:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e': evict_method = evict_method_parse(optarg); break;
+            case 'E': evict_batch = strtoull(optarg, NULL, 0); break;
+            case 'i': isa = isa_parse(optarg); break;
+            case 'M': policy = mem_policy_parse(optarg); break;
+            case 'o': results_path = optarg; break;
+            case 'r': repeats = atoi(optarg); break;
+            case 's': page_sample = strtoull(optarg, NULL, 0); break;
+            case 't': timeline_path = optarg; break;
+            case 'T': sample_interval_ms = atof(optarg); break;
+            case 'W': warmup = atoi(optarg); break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (!isa_supported(isa))
+    {
+        XBT_ERROR("instruction set %s is not supported by this CPU.", isa_name(isa));
+        exit(EXIT_FAILURE);
+    }
+    checksum_kernel_t checksum_read = checksum_kernel_get(isa);
+
+    if (!evict_method_supported(evict_method))
+    {
+        XBT_ERROR("%s is not supported by this CPU.", evict_method_name(evict_method));
+        exit(EXIT_FAILURE);
+    }
+
     size_t payload_bytes = PAYLOAD_BYTES;
 
     hwloc_topology_t topology;
@@ -41,8 +96,17 @@ int main(int argc, char *argv[])
     hwloc_topology_init(&topology);
     hwloc_topology_load(topology);
 
+    // Counters for the calling thread, enabled only around the write and read phases.
+    perf_counters_t counters = perf_counters_open();
+    results_file_t results = results_open(results_path);
+    results_file_t timeline = results_open(timeline_path);
+    numa_sampler_t sampler;
+    locality_monitor_t write_locality, read_locality;
+    evict_t evict = evict_open(topology, evict_method, evict_batch);
+
     // Emulate memory writting by saving data into memory.
-    char *buffer = (char *)malloc(payload_bytes);
+    dram_buffer_t dram_buffer = dram_buffer_alloc(topology, payload_bytes, DRAM_BACKEND_PAGES, policy);
+    char *buffer = dram_buffer.ptr;
     if (!buffer)
     {
         XBT_ERROR("unable to create write buffer. errno: %d, error: %s", errno, strerror(errno));
@@ -50,160 +114,106 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
-    // Emulate memory writting by saving data into memory.
-    double write_start_timestamp_us = get_time_us();
-
-    // Step 1: Write data using memset
-    memset(buffer, 0, payload_bytes);
-    // Step 2: Memory fence to ensure memset is complete
-    _mm_mfence();
-
-    double write_end_timestamp_us = get_time_us();
-
-    // Get data locality after writing.
-    std::vector<int> nlaw = thread_numa_get(topology, buffer, payload_bytes);
-
-    // Step 3: Flush every cache line in the region
-    for (size_t offset = 0; offset < payload_bytes; offset += CACHE_LINE_SIZE) {
-        _mm_clflush(buffer + offset);
+    // The first iterations fault the pages in and warm up caches and TLBs;
+    // only the following ones are reported.
+    std::vector<double> write_times_us, read_times_us;
+    for (int iteration = 0; iteration < warmup + repeats; iteration++)
+    {
+        // Emulate memory writting by saving data into memory.
+        locality_monitor_start(write_locality);
+        perf_counters_start(counters);
+        chunk_timing_t write_timing = chunk_timed_run(payload_bytes, CHUNK_BYTES,
+            [&](size_t offset, size_t length) {
+                locality_monitor_sample(write_locality);
+                // Step 1: Write data using memset
+                memset(buffer + offset, 0, length);
+                // Step 2: Memory fence to ensure memset is complete
+                _mm_mfence();
+            });
+        perf_counters_stop(counters);
+        locality_monitor_stop(write_locality);
+        std::vector<perf_counter_value_t> write_counters = perf_counters_read(counters);
+        chunk_stats_t write_stats = chunk_stats_get(write_timing);
+
+        // Get data locality after writing.
+        std::vector<int> nlaw = thread_numa_get(topology, buffer, payload_bytes);
+        page_placement_t pages_write = page_placement_get(buffer, payload_bytes, page_sample);
+
+        // Step 3: Evict the region from the caches, untimed, one fence per batch
+        double evict_us = evict_run(evict, buffer, payload_bytes);
+
+        size_t checksum = 0;
+        if (sample_interval_ms > 0)
+            numa_sampler_start(sampler, buffer, payload_bytes, sample_interval_ms);
+        locality_monitor_start(read_locality);
+        perf_counters_start(counters);
+        chunk_timing_t read_timing = chunk_timed_run(payload_bytes, CHUNK_BYTES,
+            [&](size_t offset, size_t length) { locality_monitor_sample(read_locality); checksum += checksum_read(buffer + offset, length); });
+        perf_counters_stop(counters);
+        locality_monitor_stop(read_locality);
+        if (sample_interval_ms > 0)
+            numa_sampler_stop(sampler);
+        std::vector<perf_counter_value_t> read_counters = perf_counters_read(counters);
+        chunk_stats_t read_stats = chunk_stats_get(read_timing);
+
+        // Used to check data (pages) migration. Migration is trigered once the data is being read.
+        std::vector<int> nlar = thread_numa_get(topology, buffer, payload_bytes);
+        page_placement_t pages_read = page_placement_get(buffer, payload_bytes, page_sample);
+
+        thread_locality_t locality = thread_get_locality_from_os(topology);
+
+        if (iteration < warmup)
+            continue;
+
+        write_times_us.push_back(write_stats.time_us);
+        read_times_us.push_back(read_stats.time_us);
+
+        result_record_t record;
+        record_add_locality(record, locality);
+        record_add(record, "checksum", (long)checksum);
+        record_add(record, "numa_write", "[" + join(nlaw) + "]");
+        record_add(record, "numa_read", "[" + join(nlar) + "]");
+        record_add(record, "pages_write", page_placement_str(pages_write));
+        record_add(record, "pages_read", page_placement_str(pages_read));
+        record_add(record, "pages_migration", page_migration_str(page_placement_diff(pages_write, pages_read)));
+        record_add(record, "write_time_us", write_stats.time_us);
+        record_add(record, "read_time_us", read_stats.time_us);
+        record_add(record, "write_chunk_gbps", chunk_stats_str(write_stats));
+        record_add(record, "read_chunk_gbps", chunk_stats_str(read_stats));
+        record_add(record, "write_counters", perf_counters_str(write_counters));
+        record_add(record, "read_counters", perf_counters_str(read_counters));
+        record_add(record, "write_locality", locality_monitor_str(write_locality));
+        record_add(record, "read_locality", locality_monitor_str(read_locality));
+        record_add(record, "evict", evict_str(evict));
+        record_add(record, "evict_us", evict_us);
+        record_add(record, "policy", mem_policy_str(policy));
+        record_add(record, "isa", isa_name(isa));
+        record_add(record, "iteration", iteration - warmup);
+        record_add(record, "payload", payload_bytes);
+
+        XBT_INFO("%s", record_str(record).c_str());
+        results_write(results, record);
+
+        if (sample_interval_ms > 0)
+            numa_timeline_log(sampler, read_timing, iteration - warmup, timeline);
     }
 
-    // Step 4: Final fence to ensure all flushes are complete
-    _mm_mfence();
+    if (repeats > 1)
+        XBT_INFO("write_time_us: %s, read_time_us: %s, repeats: %d, warmup: %d.",
+            repeat_stats_str(repeat_stats_get(write_times_us)).c_str(),
+            repeat_stats_str(repeat_stats_get(read_times_us)).c_str(),
+            repeats, warmup);
 
-    double read_start_timestemp_us = get_time_us();
+    results_close(results);
+    results_close(timeline);
 
-    size_t checksum = 0;
-    for (size_t i = 0; i < payload_bytes; i++)
-        checksum += buffer[i]; // Access each byte in the buffer (simulates reading)
+    evict_close(evict);
 
-    double read_end_timestemp_us = get_time_us();
+    dram_buffer_free(dram_buffer);
 
-    // Used to check data (pages) migration. Migration is trigered once the data is being read.
-    std::vector<int> nlar = thread_numa_get(topology, buffer, payload_bytes);
-
-    thread_locality_t locality = thread_get_locality_from_os(topology);
-    XBT_INFO("numa_id: %d, code_id: %d, vcs: %ld, ics: %ld, mig: %ld, checksum: %ld, numa_write: [%s], numa_read: [%s], write_time_us: %f, read_time_us: %f, payload: %ld.",
-        locality.numa_id, locality.core_id, locality.voluntary_context_switches, 
-        locality.involuntary_context_switches, locality.core_migrations,
-        checksum, join(nlaw).c_str(), join(nlar).c_str(),
-        write_end_timestamp_us - write_start_timestamp_us,
-        read_end_timestemp_us - read_start_timestemp_us,
-        payload_bytes
-    );
-
-    free(buffer);
+    perf_counters_close(counters);
 
     hwloc_topology_destroy(topology);
 
     return 0;
 }
-
-double get_time_us()
-{
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (double)tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
-std::string join(const std::vector<int> &vec, const std::string &delimiter)
-{
-    std::ostringstream oss;
-
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        oss << vec[i];
-        if (i != vec.size() - 1)
-        { // Avoid adding a delimiter after the last element
-            oss << delimiter;
-        }
-    }
-
-    return oss.str();
-}
-
-std::vector<int> thread_numa_get(hwloc_topology_t topology, char *address, size_t size)
-{
-    /* Get data locality (NUMA nodes were data pages are allocated) */
-    hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
-    std::vector<int> numa_nodes;
-
-    if (hwloc_get_area_memlocation(topology, address, size, nodeset, HWLOC_MEMBIND_BYNODESET) != 0)
-    {
-        XBT_ERROR("failed to retrieve memory binding for address: %p", address);
-        throw std::runtime_error(std::string("failed to retrieve memory binding for address: ") + address);    
-    }
-
-    int node;
-    hwloc_bitmap_foreach_begin(node, nodeset)
-    {
-        numa_nodes.push_back(node); // Add NUMA node ID to the vector
-    }
-    hwloc_bitmap_foreach_end();
-
-    // Cleanup
-    hwloc_bitmap_free(nodeset);
-
-    return numa_nodes;
-}
-
-thread_locality_t thread_get_locality_from_os(hwloc_topology_t topology)
-{
-    // Get the current thread's CPU binding
-    hwloc_bitmap_t cpuset = hwloc_bitmap_alloc();
-    hwloc_get_last_cpu_location(topology, cpuset, HWLOC_CPUBIND_THREAD);
-
-    // Get the NUMA node on which the current thread is running
-    hwloc_bitmap_t nodeset = hwloc_bitmap_alloc();
-    hwloc_cpuset_to_nodeset(topology, cpuset, nodeset);
-
-    int numa_id = hwloc_bitmap_first(nodeset); // Get the first NUMA node
-
-    // Get the core object corresponding to the CPU binding
-    hwloc_obj_t obj = hwloc_get_obj_covering_cpuset(topology, cpuset);
-
-    // Cleanup
-    hwloc_bitmap_free(cpuset);
-    hwloc_bitmap_free(nodeset);
-
-    // Traverse up the object hierarchy to find the core object
-    while (obj && obj->type != HWLOC_OBJ_CORE) obj = obj->parent;
-
-    if (!obj)
-    {
-        XBT_ERROR("failed to get core object.");
-        throw std::runtime_error("failed to get core object.");
-    }
-
-    int core_id = obj->logical_index; // Get the logical core ID
-
-    // Retrieve core migration information from /proc/self/sched
-    std::ifstream sched_file("/proc/self/sched");
-
-    if (!sched_file.is_open()) {
-        XBT_ERROR("failed to open /proc/self/sched: %s", strerror(errno));
-        throw std::runtime_error("failed to open process scheduling information.");
-    }
-
-    std::string line;
-    int core_migrations;
-    while (std::getline(sched_file, line))
-    {
-        if (line.find("nr_migrations") != std::string::npos)
-        {
-            std::istringstream iss(line);
-            std::string label;
-            iss >> label >> core_migrations; // Extract migration count
-            break;
-        }
-    }
-    sched_file.close();
-
-    // Get context switch information using getrusage
-    struct rusage usage;
-    getrusage(RUSAGE_THREAD, &usage);
-
-    // Return locality and context switch information along with core migrations
-    return {numa_id, core_id, usage.ru_nvcsw, usage.ru_nivcsw, core_migrations};
-}
-
@@ -1,53 +1,126 @@
 #include <hwloc.h>
-#include <sys/time.h>
 #include <xbt/log.h>
 #include <vector>
 #include <sstream>
 #include <sys/resource.h> // For getrusage
 #include <fstream>
 #include <immintrin.h>  // For intrinsics
-#include <iostream>
+#include <getopt.h>
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
 
+#include "common.h"
+#include "timing.h"
+#include "perf_counters.h"
+#include "placement.h"
+#include "dram_alloc.h"
+#include "isa.h"
+#include "pattern.h"
+#include "evict.h"
+#include "results.h"
+#include "numa_sampler.h"
+#include "locality.h"
+
 // Buffer aligned to cache line size (typically 64 bytes)
 #define CACHE_LINE_SIZE 64
 #define ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
 
-struct thread_locality_s
-{
-    int numa_id;
-    int core_id;
-    long voluntary_context_switches;
-    long involuntary_context_switches;
-    long core_migrations;
-};
-typedef struct thread_locality_s thread_locality_t;
-
-double get_time_us();
+dram_buffer_t create_dram_buffer(hwloc_topology_t topology, size_t size, dram_backend_t backend, const mem_policy_t &policy);
+void dram_kernels_select(isa_t isa);
 
-void* create_dram_buffer(size_t size);
-void dram_write(void* dest, const void* src, size_t size);
-void dram_read(void* dest, const void* src, size_t size);
+// Selected at startup by dram_kernels_select.
+typedef void (*dram_kernel_t)(void* dest, const void* src, size_t size);
+dram_kernel_t dram_write = NULL;
+dram_kernel_t dram_read = NULL;
 
-std::string join(const std::vector<int> &vec, const std::string &delimiter=",");
-std::vector<int> thread_numa_get(hwloc_topology_t topology, char *address, size_t size);
-thread_locality_t thread_get_locality_from_os(hwloc_topology_t topology);
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-b backend] [-i isa] [-m mem_node] [-M policy] [-p payload_bytes] [-o results] [-r repeats] [-s page_sample] [-t timeline] [-T interval_ms] [-v verify] [-W warmup]\n"
+        "  -b  allocation backend: pages, thp, hugetlb-2m or hugetlb-1g (default: pages)\n"
+        "  -i  kernel instruction set: scalar, sse, avx2 or avx512 (default: widest supported)\n"
+        "  -m  NUMA node the buffer is bound to, same as -M bind:mem_node (default: none, use numactl --membind)\n"
+        "  -M  memory policy: default, bind:N[,N...], interleave:N[,N...] or first-touch:N (default: default)\n"
+        "  -p  buffer size in bytes (default: 4 GiB)\n"
+        "  -o  also write one JSON line per iteration to this file, or CSV if it ends in .csv\n"
+        "  -r  measured iterations of the write and read phases (default: 1)\n"
+        "  -s  query the NUMA node of one page out of every page_sample pages (default: 1, every page)\n"
+        "  -t  write the read-phase NUMA timeline to this file (JSON lines, or CSV if it ends in .csv)\n"
+        "  -T  sample /proc/vmstat and page placement every interval_ms during the read phase (default: 0, off)\n"
+        "  -W  warm-up iterations run before the measured ones, not reported (default: 0)\n"
+        "  -v  verification: copy (full-size source and read-back buffers, memcmp) or\n"
+        "      pattern (generated source, each chunk checked after it is read) (default: copy)\n",
+        program);
+}
 
 int main(int argc, char *argv[])
 {
     // Initialize XBT logging system
     xbt_log_init(&argc, argv);
 
+    dram_backend_t backend = DRAM_BACKEND_PAGES;
+    isa_t isa = isa_best();
+    mem_policy_t policy = {MEM_POLICY_DEFAULT, {}};
+    size_t buffer_size = 4ULL * 1024 * 1024 * 1024;
+    size_t page_sample = 1;
+    int repeats = 1;
+    int warmup = 0;
+    std::string results_path;
+    std::string timeline_path;
+    double sample_interval_ms = 0;
+    bool verify_pattern = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:i:m:M:p:o:r:s:v:t:T:W:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': backend = dram_backend_parse(optarg); break;
+            case 'i': isa = isa_parse(optarg); break;
+            case 'm': policy = mem_policy_bind(atoi(optarg)); break;
+            case 'M': policy = mem_policy_parse(optarg); break;
+            case 'p': buffer_size = strtoull(optarg, NULL, 0); break;
+            case 'o': results_path = optarg; break;
+            case 'r': repeats = atoi(optarg); break;
+            case 's': page_sample = strtoull(optarg, NULL, 0); break;
+            case 'v':
+                verify_pattern = strcmp(optarg, "pattern") == 0;
+                if (!verify_pattern && strcmp(optarg, "copy") != 0)
+                {
+                    XBT_ERROR("unknown verification mode: %s (expected copy or pattern)", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't': timeline_path = optarg; break;
+            case 'T': sample_interval_ms = atof(optarg); break;
+            case 'W': warmup = atoi(optarg); break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    if (!isa_supported(isa))
+    {
+        XBT_ERROR("instruction set %s is not supported by this CPU.", isa_name(isa));
+        exit(EXIT_FAILURE);
+    }
+    dram_kernels_select(isa);
+
     hwloc_topology_t topology;
 
     // Runtime system status.
     hwloc_topology_init(&topology);
     hwloc_topology_load(topology);
 
+    // Counters for the calling thread, enabled only around the write and read phases.
+    perf_counters_t counters = perf_counters_open();
+    results_file_t results = results_open(results_path);
+    results_file_t timeline = results_open(timeline_path);
+    numa_sampler_t sampler;
+    locality_monitor_t write_locality, read_locality;
+
     // Emulate memory writting by saving data into memory.
-    const size_t buffer_size = 4ULL * 1024 * 1024 * 1024;
-    void* dram_buffer = create_dram_buffer(buffer_size);
+    dram_buffer_t dram_mapping = create_dram_buffer(topology, buffer_size, backend, policy);
+    void* dram_buffer = dram_mapping.ptr;
 
     if (!dram_buffer)
     {
@@ -56,236 +129,325 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
-    // Create some test data
-    char* test_data = (char*)malloc(buffer_size);
-    memset(test_data, 0xAA, buffer_size);
-
-    // Write to DRAM
-    double write_start_timestamp_us = get_time_us();
-    dram_write(dram_buffer, test_data, buffer_size);
-    double write_end_timestamp_us = get_time_us();
-
-    // Get data locality after writing.
-    std::vector<int> nlaw = thread_numa_get(topology, (char *)dram_buffer, buffer_size);
-
-    // Read back from DRAM
-    char* read_back = (char*)malloc(buffer_size);
-
-    double read_start_timestemp_us = get_time_us();
-    dram_read(read_back, dram_buffer, buffer_size);
-    double read_end_timestemp_us = get_time_us();
-
-    // Verify data
-    if (memcmp(test_data, read_back, buffer_size) != 0) {
-        XBT_ERROR("Data mismatch after read-back.");
-        free(read_back);
-        free(test_data);
-        free(dram_buffer);
+    // Source and read-back data. In copy mode both are full-size buffers; in
+    // pattern mode they are one chunk each, generated and checked per chunk
+    // outside the timed region, so only the buffer under test is large.
+    size_t data_size = verify_pattern ? (size_t)CHUNK_BYTES : buffer_size;
+    char* test_data = (char*)malloc(data_size);
+    char* read_back = (char*)malloc(data_size);
+    if (!test_data || !read_back)
+    {
+        XBT_ERROR("unable to create source and read-back buffers. errno: %d, error: %s", errno, strerror(errno));
+        dram_buffer_free(dram_mapping);
         hwloc_topology_destroy(topology);
         exit(EXIT_FAILURE);
     }
+    if (!verify_pattern)
+        memset(test_data, 0xAA, buffer_size);
+
+    // Offset of a chunk inside test_data and read_back.
+    auto data_offset = [&](size_t offset) { return verify_pattern ? 0 : offset; };
+
+    // Pattern mode reuses one chunk; it is flushed, untimed, before every
+    // timed write and read so it comes from DRAM as the full-size buffers of
+    // copy mode do, instead of hitting in the cache.
+    evict_t evict = evict_open(topology, evict_method_best());
+    size_t mismatch = SIZE_MAX;
+
+    // The first iterations fault the pages in and warm up caches and TLBs;
+    // only the following ones are reported.
+    std::vector<double> write_times_us, read_times_us;
+    for (int iteration = 0; iteration < warmup + repeats; iteration++)
+    {
+        // Write to DRAM
+        locality_monitor_start(write_locality);
+        perf_counters_start(counters);
+        chunk_timing_t write_timing = chunk_timed_run(buffer_size, CHUNK_BYTES,
+            [&](size_t offset, size_t length) {
+                locality_monitor_sample(write_locality);
+                if (verify_pattern)
+                {
+                    pattern_fill(test_data, offset, length);
+                    evict_run(evict, test_data, length);
+                }
+            },
+            [&](size_t offset, size_t length) { dram_write((char*)dram_buffer + offset, test_data + data_offset(offset), length); },
+            [&](size_t, size_t) {});
+        perf_counters_stop(counters);
+        locality_monitor_stop(write_locality);
+        std::vector<perf_counter_value_t> write_counters = perf_counters_read(counters);
+        chunk_stats_t write_stats = chunk_stats_get(write_timing);
+
+        // Get data locality and the page size obtained after writing.
+        dram_pages_t pages = dram_buffer_pages(dram_mapping);
+        std::vector<int> nlaw = thread_numa_get(topology, (char *)dram_buffer, buffer_size);
+        page_placement_t pages_write = page_placement_get((char *)dram_buffer, buffer_size, page_sample);
+
+        // Read back from DRAM
+        if (sample_interval_ms > 0)
+            numa_sampler_start(sampler, (char *)dram_buffer, buffer_size, sample_interval_ms);
+        locality_monitor_start(read_locality);
+        perf_counters_start(counters);
+        chunk_timing_t read_timing = chunk_timed_run(buffer_size, CHUNK_BYTES,
+            [&](size_t, size_t length) {
+                locality_monitor_sample(read_locality);
+                if (verify_pattern)
+                    evict_run(evict, read_back, length);
+            },
+            [&](size_t offset, size_t length) { dram_read(read_back + data_offset(offset), (char*)dram_buffer + offset, length); },
+            [&](size_t offset, size_t length) {
+                if (verify_pattern && mismatch == SIZE_MAX)
+                    mismatch = pattern_check(read_back, offset, length);
+            });
+        perf_counters_stop(counters);
+        locality_monitor_stop(read_locality);
+        if (sample_interval_ms > 0)
+            numa_sampler_stop(sampler);
+        std::vector<perf_counter_value_t> read_counters = perf_counters_read(counters);
+        chunk_stats_t read_stats = chunk_stats_get(read_timing);
+
+        // Verify data
+        bool mismatched = verify_pattern ? mismatch != SIZE_MAX : memcmp(test_data, read_back, buffer_size) != 0;
+
+        if (mismatched) {
+            if (verify_pattern)
+                XBT_ERROR("Data mismatch after read-back at byte %zu.", mismatch);
+            else
+                XBT_ERROR("Data mismatch after read-back.");
+            free(read_back);
+            free(test_data);
+            dram_buffer_free(dram_mapping);
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
     
-    // Used to check data (pages) migration. Migration is trigered once the data is being read.
-    std::vector<int> nlar = thread_numa_get(topology, (char *)dram_buffer, buffer_size);
-
-    thread_locality_t locality = thread_get_locality_from_os(topology);
-    XBT_INFO("numa_id: %d, code_id: %d, vcs: %ld, ics: %ld, mig: %ld, numa_write: [%s], numa_read: [%s], write_time_us: %f, read_time_us: %f, payload: %ld.",
-        locality.numa_id, locality.core_id, locality.voluntary_context_switches, 
-        locality.involuntary_context_switches, locality.core_migrations,
-        join(nlaw).c_str(), join(nlar).c_str(),
-        write_end_timestamp_us - write_start_timestamp_us,
-        read_end_timestemp_us - read_start_timestemp_us,
-        buffer_size
-    );
-
-    free(dram_buffer);
+        // Used to check data (pages) migration. Migration is trigered once the data is being read.
+        std::vector<int> nlar = thread_numa_get(topology, (char *)dram_buffer, buffer_size);
+        page_placement_t pages_read = page_placement_get((char *)dram_buffer, buffer_size, page_sample);
+
+        thread_locality_t locality = thread_get_locality_from_os(topology);
+
+        if (iteration < warmup)
+            continue;
+
+        write_times_us.push_back(write_stats.time_us);
+        read_times_us.push_back(read_stats.time_us);
+
+        result_record_t record;
+        record_add_locality(record, locality);
+        record_add(record, "numa_write", "[" + join(nlaw) + "]");
+        record_add(record, "numa_read", "[" + join(nlar) + "]");
+        record_add(record, "pages_write", page_placement_str(pages_write));
+        record_add(record, "pages_read", page_placement_str(pages_read));
+        record_add(record, "pages_migration", page_migration_str(page_placement_diff(pages_write, pages_read)));
+        record_add(record, "write_time_us", write_stats.time_us);
+        record_add(record, "read_time_us", read_stats.time_us);
+        record_add(record, "write_chunk_gbps", chunk_stats_str(write_stats));
+        record_add(record, "read_chunk_gbps", chunk_stats_str(read_stats));
+        record_add(record, "write_counters", perf_counters_str(write_counters));
+        record_add(record, "read_counters", perf_counters_str(read_counters));
+        record_add(record, "write_locality", locality_monitor_str(write_locality));
+        record_add(record, "read_locality", locality_monitor_str(read_locality));
+        record_add(record, "policy", mem_policy_str(policy));
+        record_add(record, "backend", dram_backend_name(backend));
+        record_add(record, "page_size", pages.kernel_page_size);
+        record_add(record, "huge_bytes", pages.huge_bytes);
+        record_add(record, "isa", isa_name(isa));
+        record_add(record, "verify", verify_pattern ? "pattern" : "copy");
+        record_add(record, "iteration", iteration - warmup);
+        record_add(record, "payload", buffer_size);
+
+        XBT_INFO("%s", record_str(record).c_str());
+        results_write(results, record);
+
+        if (sample_interval_ms > 0)
+            numa_timeline_log(sampler, read_timing, iteration - warmup, timeline);
+    }
+
+    if (repeats > 1)
+        XBT_INFO("write_time_us: %s, read_time_us: %s, repeats: %d, warmup: %d.",
+            repeat_stats_str(repeat_stats_get(write_times_us)).c_str(),
+            repeat_stats_str(repeat_stats_get(read_times_us)).c_str(),
+            repeats, warmup);
+
+    results_close(results);
+    results_close(timeline);
+
+    dram_buffer_free(dram_mapping);
     free(test_data);
     free(read_back);
 
+    evict_close(evict);
+    perf_counters_close(counters);
+
     hwloc_topology_destroy(topology);
 
     return 0;
 }
 
-double get_time_us()
-{
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (double)tv.tv_sec * 1000000 + tv.tv_usec;
-}
-
-// Create an uncached buffer
-void* create_dram_buffer(size_t size) {
-    void* ptr;
-    if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0) {
-        return NULL;
+// Create a NUMA-bound buffer with the selected page size and touch every page
+dram_buffer_t create_dram_buffer(hwloc_topology_t topology, size_t size, dram_backend_t backend, const mem_policy_t &policy) {
+    dram_buffer_t buffer = dram_buffer_alloc(topology, size, backend, policy);
+    if (buffer.ptr) {
+        memset(buffer.ptr, 0, size);
     }
-    memset(ptr, 0, size);
-    return ptr;
+    return buffer;
 }
 
-// Non-temporal write (bypasses cache)
-void dram_write(void* dest, const void* src, size_t size) {
+// Non-temporal write (bypasses cache), one variant per instruction set.
+// Loads are unaligned; dest must be aligned to the vector width.
+void dram_write_scalar(void* dest, const void* src, size_t size) {
     size_t i;
     char* d = (char*)dest;
     const char* s = (const char*)src;
-    
-    // Use non-temporal stores for large blocks
-    #ifdef __AVX512F__
-    for (i = 0; i + 64 <= size; i += 64) {
-        __m512i val = _mm512_loadu_si512((__m512i*)(s + i));
-        _mm512_stream_si512((__m512i*)(d + i), val);
+
+    for (i = 0; i + 8 <= size; i += 8) {
+        long long val;
+        memcpy(&val, s + i, sizeof(val));
+        _mm_stream_si64((long long*)(d + i), val);
     }
-    #elif defined(__AVX__)
-    for (i = 0; i + 32 <= size; i += 32) {
-        __m256i val = _mm256_loadu_si256((__m256i*)(s + i));
-        _mm256_stream_si256((__m256i*)(d + i), val);
+
+    // Handle remaining bytes
+    for (; i < size; i++) {
+        d[i] = s[i];
     }
-    #else
+
+    _mm_sfence();
+}
+
+void dram_write_sse(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
+
     for (i = 0; i + 16 <= size; i += 16) {
         __m128i val = _mm_loadu_si128((__m128i*)(s + i));
         _mm_stream_si128((__m128i*)(d + i), val);
     }
-    #endif
-    
-    // Handle remaining bytes
+
     for (; i < size; i++) {
         d[i] = s[i];
     }
-    
+
     _mm_sfence();
 }
 
-// Non-temporal read (bypasses cache)
-void dram_read(void* dest, const void* src, size_t size) {
+__attribute__((target("avx2")))
+void dram_write_avx2(void* dest, const void* src, size_t size) {
     size_t i;
     char* d = (char*)dest;
     const char* s = (const char*)src;
-    
-    // Use non-temporal loads for large blocks
-    #ifdef __AVX512F__
-    for (i = 0; i + 64 <= size; i += 64) {
-        __m512i val = _mm512_stream_load_si512((__m512i*)(s + i));
-        _mm512_storeu_si512((__m512i*)(d + i), val);
-    }
-    #elif defined(__AVX__)
+
     for (i = 0; i + 32 <= size; i += 32) {
-        __m256i val = _mm256_stream_load_si256((__m256i*)(s + i));
-        _mm256_storeu_si256((__m256i*)(d + i), val);
-    }
-    #else
-    for (i = 0; i + 16 <= size; i += 16) {
-        __m128i val = _mm_stream_load_si128((__m128i*)(s + i));
-        _mm_storeu_si128((__m128i*)(d + i), val);
+        __m256i val = _mm256_loadu_si256((__m256i*)(s + i));
+        _mm256_stream_si256((__m256i*)(d + i), val);
     }
-    #endif
-    
-    // Handle remaining bytes
+
     for (; i < size; i++) {
         d[i] = s[i];
     }
-    
-    _mm_lfence();
+
+    _mm_sfence();
 }
 
-std::string join(const std::vector<int> &vec, const std::string &delimiter)
-{
-    std::ostringstream oss;
+__attribute__((target("avx512f")))
+void dram_write_avx512(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
 
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        oss << vec[i];
-        if (i != vec.size() - 1)
-        { // Avoid adding a delimiter after the last element
-            oss << delimiter;
-        }
+    for (i = 0; i + 64 <= size; i += 64) {
+        __m512i val = _mm512_loadu_si512((__m512i*)(s + i));
+        _mm512_stream_si512((__m512i*)(d + i), val);
     }
 
-    return oss.str();
+    for (; i < size; i++) {
+        d[i] = s[i];
+    }
+
+    _mm_sfence();
 }
 
-std::vector<int> thread_numa_get(hwloc_topology_t topology, char *address, size_t size)
-{
-    /* Get data locality (NUMA nodes were data pages are allocated) */
-    hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
-    std::vector<int> numa_nodes;
+// Non-temporal read (bypasses cache), one variant per instruction set.
+// src must be aligned to the vector width; stores are unaligned.
+void dram_read_scalar(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
 
-    if (hwloc_get_area_memlocation(topology, address, size, nodeset, HWLOC_MEMBIND_BYNODESET) != 0)
-    {
-        XBT_ERROR("failed to retrieve memory binding for address: %p", address);
-        throw std::runtime_error(std::string("failed to retrieve memory binding for address: ") + address);    
+    // No non-temporal load without SSE4.1: plain 8-byte loads.
+    for (i = 0; i + 8 <= size; i += 8) {
+        uint64_t val = *(const volatile uint64_t*)(s + i);
+        memcpy(d + i, &val, sizeof(val));
     }
 
-    int node;
-    hwloc_bitmap_foreach_begin(node, nodeset)
-    {
-        numa_nodes.push_back(node); // Add NUMA node ID to the vector
+    for (; i < size; i++) {
+        d[i] = s[i];
     }
-    hwloc_bitmap_foreach_end();
-
-    // Cleanup
-    hwloc_bitmap_free(nodeset);
 
-    return numa_nodes;
+    _mm_lfence();
 }
 
-thread_locality_t thread_get_locality_from_os(hwloc_topology_t topology)
-{
-    // Get the current thread's CPU binding
-    hwloc_bitmap_t cpuset = hwloc_bitmap_alloc();
-    hwloc_get_last_cpu_location(topology, cpuset, HWLOC_CPUBIND_THREAD);
+__attribute__((target("sse4.1")))
+void dram_read_sse(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
 
-    // Get the NUMA node on which the current thread is running
-    hwloc_bitmap_t nodeset = hwloc_bitmap_alloc();
-    hwloc_cpuset_to_nodeset(topology, cpuset, nodeset);
+    for (i = 0; i + 16 <= size; i += 16) {
+        __m128i val = _mm_stream_load_si128((__m128i*)(s + i));
+        _mm_storeu_si128((__m128i*)(d + i), val);
+    }
 
-    int numa_id = hwloc_bitmap_first(nodeset); // Get the first NUMA node
+    for (; i < size; i++) {
+        d[i] = s[i];
+    }
 
-    // Get the core object corresponding to the CPU binding
-    hwloc_obj_t obj = hwloc_get_obj_covering_cpuset(topology, cpuset);
+    _mm_lfence();
+}
 
-    // Cleanup
-    hwloc_bitmap_free(cpuset);
-    hwloc_bitmap_free(nodeset);
+__attribute__((target("avx2")))
+void dram_read_avx2(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
 
-    // Traverse up the object hierarchy to find the core object
-    while (obj && obj->type != HWLOC_OBJ_CORE) obj = obj->parent;
+    for (i = 0; i + 32 <= size; i += 32) {
+        __m256i val = _mm256_stream_load_si256((__m256i*)(s + i));
+        _mm256_storeu_si256((__m256i*)(d + i), val);
+    }
 
-    if (!obj)
-    {
-        XBT_ERROR("failed to get core object.");
-        throw std::runtime_error("failed to get core object.");
+    for (; i < size; i++) {
+        d[i] = s[i];
     }
 
-    int core_id = obj->logical_index; // Get the logical core ID
+    _mm_lfence();
+}
 
-    // Retrieve core migration information from /proc/self/sched
-    std::ifstream sched_file("/proc/self/sched");
+__attribute__((target("avx512f")))
+void dram_read_avx512(void* dest, const void* src, size_t size) {
+    size_t i;
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
 
-    if (!sched_file.is_open()) {
-        XBT_ERROR("failed to open /proc/self/sched: %s", strerror(errno));
-        throw std::runtime_error("failed to open process scheduling information.");
+    for (i = 0; i + 64 <= size; i += 64) {
+        __m512i val = _mm512_stream_load_si512((__m512i*)(s + i));
+        _mm512_storeu_si512((__m512i*)(d + i), val);
     }
 
-    std::string line;
-    int core_migrations;
-    while (std::getline(sched_file, line))
-    {
-        if (line.find("nr_migrations") != std::string::npos)
-        {
-            std::istringstream iss(line);
-            std::string label;
-            iss >> label >> core_migrations; // Extract migration count
-            break;
-        }
+    for (; i < size; i++) {
+        d[i] = s[i];
     }
-    sched_file.close();
 
-    // Get context switch information using getrusage
-    struct rusage usage;
-    getrusage(RUSAGE_THREAD, &usage);
-
-    // Return locality and context switch information along with core migrations
-    return {numa_id, core_id, usage.ru_nvcsw, usage.ru_nivcsw, core_migrations};
+    _mm_lfence();
 }
 
+// Points dram_write/dram_read at the variants of the given instruction set.
+void dram_kernels_select(isa_t isa) {
+    switch (isa) {
+        case ISA_AVX512: dram_write = dram_write_avx512; dram_read = dram_read_avx512; break;
+        case ISA_AVX2: dram_write = dram_write_avx2; dram_read = dram_read_avx2; break;
+        case ISA_SSE: dram_write = dram_write_sse; dram_read = dram_read_sse; break;
+        default: dram_write = dram_write_scalar; dram_read = dram_read_scalar; break;
+    }
+}
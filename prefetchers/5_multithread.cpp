@@ -0,0 +1,123 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "bandwidth.h"
+
+#define PAYLOAD_BYTES 4ULL * 1024 * 1024 * 1024
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_node] [-k core_avail_mask] [-t threads] [-p payload_bytes]\n"
+        "  -c  NUMA node whose cores run the threads (default: 0)\n"
+        "  -m  NUMA node the buffer is bound to (default: 0)\n"
+        "  -k  core_avail_mask as in the templates, e.g. 0xFF or 0xF00000F (overrides -c)\n"
+        "  -t  number of threads (default: one per selected core)\n"
+        "  -p  total payload in bytes, split evenly across threads (default: 4 GiB)\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    int mem_numa_id = 0;
+    int num_threads = 0;
+    std::string core_avail_mask;
+    size_t payload_bytes = PAYLOAD_BYTES;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:k:t:p:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_numa_id = atoi(optarg); break;
+            case 'k': core_avail_mask = optarg; break;
+            case 't': num_threads = atoi(optarg); break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    std::vector<int> pus = cpu_pus_get(topology, core_avail_mask, cpu_numa_id);
+    if (num_threads <= 0 || num_threads > (int)pus.size())
+        num_threads = pus.size();
+    pus.resize(num_threads);
+
+    if (num_threads == 0)
+    {
+        XBT_ERROR("no cores available for the selected node/mask.");
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    // Bind the whole buffer to the memory node; pages are placed on first touch by the workers.
+    hwloc_nodeset_t nodeset = numa_nodeset_get(topology, mem_numa_id);
+    char *buffer = (char *)hwloc_alloc_membind(topology, payload_bytes, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+    hwloc_bitmap_free(nodeset);
+
+    if (!buffer)
+    {
+        XBT_ERROR("unable to create write buffer. errno: %d, error: %s", errno, strerror(errno));
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    bandwidth_result_t result = bandwidth_run(topology, buffer, payload_bytes, pus);
+    if (!result.bound || !result.located)
+    {
+        XBT_ERROR("some threads could not be %s.", !result.bound ? "bound to their PU" : "located");
+        hwloc_free(topology, buffer, payload_bytes);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    // Used to check data (pages) migration. Migration is trigered once the data is being read.
+    std::vector<int> nlar = thread_numa_get(topology, buffer, payload_bytes);
+
+    for (const bandwidth_worker_t &worker : result.workers)
+    {
+        double write_time_us = worker.write_end_timestamp_us - worker.write_start_timestamp_us;
+        double read_time_us = worker.read_end_timestemp_us - worker.read_start_timestemp_us;
+        XBT_INFO("thread: %d, pu_id: %d, numa_id: %d, core_id: %d, vcs: %ld, ics: %ld, mig: %ld, write_time_us: %f, read_time_us: %f, write_gbps: %f, read_gbps: %f, payload: %zu.",
+            worker.thread_id, worker.pu_id, worker.locality.numa_id, worker.locality.core_id,
+            worker.locality.voluntary_context_switches, worker.locality.involuntary_context_switches,
+            worker.locality.core_migrations,
+            write_time_us, read_time_us,
+            worker.size / (write_time_us * 1e3),
+            worker.size / (read_time_us * 1e3),
+            worker.size
+        );
+    }
+
+    XBT_INFO("threads: %d, cpu_numa_id: %d, mem_numa_id: %d, checksum: %lu, numa_write: [%s], numa_read: [%s], write_time_us: %f, read_time_us: %f, write_gbps: %f, read_gbps: %f, payload: %zu.",
+        num_threads, cpu_numa_id, mem_numa_id, result.checksum, join(result.nlaw).c_str(), join(nlar).c_str(),
+        result.write_time_us, result.read_time_us,
+        payload_bytes / (result.write_time_us * 1e3),
+        payload_bytes / (result.read_time_us * 1e3),
+        payload_bytes
+    );
+
+    hwloc_free(topology, buffer, payload_bytes);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
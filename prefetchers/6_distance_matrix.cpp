@@ -0,0 +1,152 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "bandwidth.h"
+#include "dram_alloc.h"
+#include "latency.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define LATENCY_BYTES 512ULL * 1024 * 1024
+#define LATENCY_ACCESSES 10000000ULL
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-o output_dir] [-t threads] [-p payload_bytes] [-l latency_bytes] [-a accesses] [-w]\n"
+        "  -o  directory receiving non_uniform_lat.txt and non_uniform_bw.txt (default: .)\n"
+        "  -t  bandwidth threads per CPU node (default: one per core of the node)\n"
+        "  -p  bandwidth payload in bytes per pair (default: 1 GiB)\n"
+        "  -l  latency buffer in bytes per pair (default: 512 MiB)\n"
+        "  -a  dependent loads timed per pair (default: 10000000)\n"
+        "  -w  fill the bandwidth matrix with write instead of read bandwidth\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    std::string output_dir = ".";
+    int num_threads = 0;
+    size_t payload_bytes = PAYLOAD_BYTES;
+    size_t latency_bytes = LATENCY_BYTES;
+    size_t latency_accesses = LATENCY_ACCESSES;
+    bool write_bandwidth = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:t:p:l:a:wh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o': output_dir = optarg; break;
+            case 't': num_threads = atoi(optarg); break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'l': latency_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': latency_accesses = strtoull(optarg, NULL, 0); break;
+            case 'w': write_bandwidth = true; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    int num_nodes = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+    std::vector<std::vector<double>> latency_ns(num_nodes, std::vector<double>(num_nodes, 0.0));
+    std::vector<std::vector<double>> bandwidth_gbps(num_nodes, std::vector<double>(num_nodes, 0.0));
+
+    // Rows are the nodes running the threads, columns the nodes holding the data.
+    for (int i = 0; i < num_nodes; i++)
+    {
+        hwloc_obj_t cpu_node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, i);
+
+        std::vector<int> pus = cpu_pus_get(topology, "", cpu_node->os_index);
+        if (pus.empty())
+        {
+            XBT_WARN("NUMA node %u has no cores (memory-only node), leaving its row at zero.", cpu_node->os_index);
+            continue;
+        }
+        if (num_threads > 0 && num_threads < (int)pus.size())
+            pus.resize(num_threads);
+
+        // The latency probe runs on the calling thread, kept on the CPU node.
+        if (hwloc_set_cpubind(topology, cpu_node->cpuset, HWLOC_CPUBIND_THREAD) != 0)
+        {
+            XBT_ERROR("unable to bind to NUMA node %u. errno: %d, error: %s", cpu_node->os_index, errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        for (int j = 0; j < num_nodes; j++)
+        {
+            hwloc_obj_t mem_node = hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, j);
+
+            char *buffer = (char *)hwloc_alloc_membind(topology, payload_bytes, mem_node->nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+            if (!buffer)
+            {
+                XBT_ERROR("unable to create buffer on NUMA node %u. errno: %d, error: %s", mem_node->os_index, errno, strerror(errno));
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+
+            bandwidth_result_t result = bandwidth_run(topology, buffer, payload_bytes, pus);
+            if (!result.bound || !result.located)
+            {
+                XBT_ERROR("some threads could not be %s on NUMA node %u.", !result.bound ? "bound to their PU" : "located", cpu_node->os_index);
+                hwloc_free(topology, buffer, payload_bytes);
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+            hwloc_free(topology, buffer, payload_bytes);
+
+            if (result.nlaw.size() != 1 || result.nlaw[0] != (int)mem_node->os_index)
+                XBT_WARN("buffer for NUMA node %u landed on nodes [%s].", mem_node->os_index, join(result.nlaw).c_str());
+
+            // The chase gets its own buffer on huge pages (see 7_pointer_chase.cpp):
+            // over 4 KiB pages nearly every load would also miss the DTLB.
+            dram_buffer_t chase = dram_buffer_alloc(topology, latency_bytes, DRAM_BACKEND_THP, mem_node->os_index);
+            if (!chase.ptr)
+            {
+                XBT_ERROR("unable to create chase buffer on NUMA node %u. errno: %d, error: %s", mem_node->os_index, errno, strerror(errno));
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+
+            latency_ns[i][j] = latency_chase_ns(chase.ptr, latency_bytes, latency_accesses);
+
+            dram_pages_t pages = dram_buffer_pages(chase);
+            if (pages.huge_bytes < latency_bytes / 2)
+                XBT_WARN("chase buffer on NUMA node %u is backed by 4 KiB pages, the latency includes TLB misses.", mem_node->os_index);
+            dram_buffer_free(chase);
+            bandwidth_gbps[i][j] = payload_bytes / ((write_bandwidth ? result.write_time_us : result.read_time_us) * 1e3);
+
+            XBT_INFO("cpu_numa_id: %u, mem_numa_id: %u, threads: %zu, numa_write: [%s], latency_ns: %f, write_gbps: %f, read_gbps: %f, payload: %zu.",
+                cpu_node->os_index, mem_node->os_index, pus.size(), join(result.nlaw).c_str(),
+                latency_ns[i][j],
+                payload_bytes / (result.write_time_us * 1e3),
+                payload_bytes / (result.read_time_us * 1e3),
+                payload_bytes
+            );
+        }
+    }
+
+    matrix_write(output_dir + "/non_uniform_lat.txt", latency_ns, "%.1f");
+    matrix_write(output_dir + "/non_uniform_bw.txt", bandwidth_gbps, "%.4f");
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
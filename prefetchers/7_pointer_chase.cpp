@@ -0,0 +1,153 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "dram_alloc.h"
+#include "latency.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define LATENCY_ACCESSES 20000000ULL
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_node] [-s line|page] [-b backend] [-p payload_bytes] [-a accesses] [-d latency_matrix]\n"
+        "  -c  NUMA node running the probe (default: 0)\n"
+        "  -m  NUMA node the buffer is bound to (default: 0)\n"
+        "  -s  one element per cache line or per 4 KiB page (default: line)\n"
+        "  -b  allocation backend: pages, thp, hugetlb-2m or hugetlb-1g (default: thp for line, pages for page)\n"
+        "  -p  buffer size in bytes, should exceed the LLC (default: 1 GiB)\n"
+        "  -a  dependent loads to time (default: 20000000)\n"
+        "  -d  latency_ns matrix (e.g. system/non_uniform_lat.txt) to report next to the measurement\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    int mem_numa_id = 0;
+    std::string stride_name = "line";
+    std::string backend_name;
+    size_t payload_bytes = PAYLOAD_BYTES;
+    size_t accesses = LATENCY_ACCESSES;
+    std::string matrix_path;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:s:b:p:a:d:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_numa_id = atoi(optarg); break;
+            case 's': stride_name = optarg; break;
+            case 'b': backend_name = optarg; break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': accesses = strtoull(optarg, NULL, 0); break;
+            case 'd': matrix_path = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    size_t stride;
+    if (stride_name == "line")
+        stride = CACHE_LINE_SIZE;
+    else if (stride_name == "page")
+        stride = PAGE_SIZE_4K;
+    else
+    {
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Over 4 KiB pages a line-mode chase takes a DTLB miss on nearly every
+    // load, so it defaults to huge pages; page mode keeps the misses on purpose.
+    if (backend_name.empty())
+        backend_name = stride == CACHE_LINE_SIZE ? "thp" : "pages";
+    dram_backend_t backend = dram_backend_parse(backend_name);
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    hwloc_obj_t cpu_node = hwloc_get_numanode_obj_by_os_index(topology, cpu_numa_id);
+    if (!cpu_node || hwloc_set_cpubind(topology, cpu_node->cpuset, HWLOC_CPUBIND_THREAD) != 0)
+    {
+        XBT_ERROR("unable to bind to NUMA node %d. errno: %d, error: %s", cpu_numa_id, errno, strerror(errno));
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    dram_buffer_t dram_buffer = dram_buffer_alloc(topology, payload_bytes, backend, mem_numa_id);
+    char *buffer = dram_buffer.ptr;
+
+    if (!buffer)
+    {
+        XBT_ERROR("unable to create chase buffer. errno: %d, error: %s", errno, strerror(errno));
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    // Building the chain writes every element, which places the pages.
+    char *head = latency_chase_build(buffer, payload_bytes, stride);
+    if (!head)
+    {
+        XBT_ERROR("buffer of %zu bytes is too small for a %zu-byte stride.", payload_bytes, stride);
+        dram_buffer_free(dram_buffer);
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    // Get data locality after writing.
+    std::vector<int> nlaw = thread_numa_get(topology, buffer, payload_bytes);
+
+    // THP is best effort; report the pages the chain actually runs over.
+    dram_pages_t pages = dram_buffer_pages(dram_buffer);
+    if (backend != DRAM_BACKEND_PAGES && pages.huge_bytes < payload_bytes / 2)
+        XBT_WARN("%s buffer is backed by 4 KiB pages, the latency includes TLB misses.", dram_backend_name(backend));
+
+    // One full lap faults in the remaining page-table entries before timing.
+    latency_chase_run_ns(&head, payload_bytes / stride);
+
+    double latency_ns = latency_chase_run_ns(&head, accesses);
+
+    // Used to check data (pages) migration. Migration is trigered once the data is being read.
+    std::vector<int> nlar = thread_numa_get(topology, buffer, payload_bytes);
+
+    double matrix_latency_ns = 0.0;
+    if (!matrix_path.empty())
+    {
+        std::vector<std::vector<double>> matrix = matrix_read(matrix_path);
+        int cpu_index = cpu_node->logical_index;
+        int mem_index = hwloc_get_numanode_obj_by_os_index(topology, mem_numa_id)->logical_index;
+        if (cpu_index < (int)matrix.size() && mem_index < (int)matrix.size())
+            matrix_latency_ns = matrix[cpu_index][mem_index];
+        else
+            XBT_WARN("latency matrix %s has no entry for pair (%d, %d).", matrix_path.c_str(), cpu_numa_id, mem_numa_id);
+    }
+
+    thread_locality_t locality = thread_get_locality_from_os(topology);
+    XBT_INFO("numa_id: %d, code_id: %d, vcs: %ld, ics: %ld, mig: %ld, mem_numa_id: %d, stride: %zu, backend: %s, page_size: %zu, huge_bytes: %zu, numa_write: [%s], numa_read: [%s], accesses: %zu, latency_ns: %f, matrix_latency_ns: %f, payload: %zu.",
+        locality.numa_id, locality.core_id, locality.voluntary_context_switches,
+        locality.involuntary_context_switches, locality.core_migrations,
+        mem_numa_id, stride, dram_backend_name(backend), pages.kernel_page_size, pages.huge_bytes, join(nlaw).c_str(), join(nlar).c_str(),
+        accesses, latency_ns, matrix_latency_ns, payload_bytes
+    );
+
+    dram_buffer_free(dram_buffer);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <x86intrin.h> // For _mm_prefetch
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+
+#define PAYLOAD_BYTES 1ULL * 1024 * 1024 * 1024
+#define CACHE_LINE_SIZE 64
+#define REPEATS 3
+
+struct prefetch_hint_s
+{
+    const char *name;
+    int hint;
+};
+typedef struct prefetch_hint_s prefetch_hint_t;
+
+static const prefetch_hint_t prefetch_hints[] = {
+    {"T0", _MM_HINT_T0},
+    {"T1", _MM_HINT_T1},
+    {"T2", _MM_HINT_T2},
+    {"NTA", _MM_HINT_NTA},
+};
+
+// Prefetch distances in bytes; 0 is the plain read without software prefetch.
+static const size_t prefetch_distances[] = {0, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384};
+
+uint64_t dram_read_prefetch(const char *ptr, size_t size, size_t distance, int hint);
+double read_gbps(const char *buffer, size_t size, size_t distance, int hint, int repeats);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_node] [-m mem_nodes] [-p payload_bytes] [-r repeats]\n"
+        "  -c  NUMA node running the reader (default: 0)\n"
+        "  -m  comma-separated memory nodes to test (default: all nodes)\n"
+        "  -p  buffer size in bytes per memory node (default: 1 GiB)\n"
+        "  -r  passes per (hint, distance), the best one is kept (default: 3)\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    int cpu_numa_id = 0;
+    std::string mem_nodes;
+    size_t payload_bytes = PAYLOAD_BYTES;
+    int repeats = REPEATS;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:p:r:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_numa_id = atoi(optarg); break;
+            case 'm': mem_nodes = optarg; break;
+            case 'p': payload_bytes = strtoull(optarg, NULL, 0); break;
+            case 'r': repeats = atoi(optarg); break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    hwloc_obj_t cpu_node = hwloc_get_numanode_obj_by_os_index(topology, cpu_numa_id);
+    if (!cpu_node || hwloc_set_cpubind(topology, cpu_node->cpuset, HWLOC_CPUBIND_THREAD) != 0)
+    {
+        XBT_ERROR("unable to bind to NUMA node %d. errno: %d, error: %s", cpu_numa_id, errno, strerror(errno));
+        hwloc_topology_destroy(topology);
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<int> mem_numa_ids = numa_ids_get(topology, mem_nodes);
+
+    for (int mem_numa_id : mem_numa_ids)
+    {
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, mem_numa_id);
+        char *buffer = (char *)hwloc_alloc_membind(topology, payload_bytes, nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET);
+        hwloc_bitmap_free(nodeset);
+
+        if (!buffer)
+        {
+            XBT_ERROR("unable to create read buffer on NUMA node %d. errno: %d, error: %s", mem_numa_id, errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+
+        memset(buffer, 1, payload_bytes);
+
+        // Get data locality after writing.
+        std::vector<int> nlaw = thread_numa_get(topology, buffer, payload_bytes);
+        const char *locality = mem_numa_id == cpu_numa_id ? "local" : "remote";
+
+        double baseline_gbps = read_gbps(buffer, payload_bytes, 0, _MM_HINT_T0, repeats);
+        double best_gbps = baseline_gbps;
+        size_t best_distance = 0;
+        const char *best_hint = "none";
+
+        for (const prefetch_hint_t &hint : prefetch_hints)
+        {
+            for (size_t distance : prefetch_distances)
+            {
+                if (distance == 0)
+                    continue;
+
+                double gbps = read_gbps(buffer, payload_bytes, distance, hint.hint, repeats);
+                XBT_INFO("cpu_numa_id: %d, mem_numa_id: %d, locality: %s, hint: %s, distance: %zu, read_gbps: %f.",
+                    cpu_numa_id, mem_numa_id, locality, hint.name, distance, gbps);
+
+                if (gbps > best_gbps)
+                {
+                    best_gbps = gbps;
+                    best_distance = distance;
+                    best_hint = hint.name;
+                }
+            }
+        }
+
+        XBT_INFO("cpu_numa_id: %d, mem_numa_id: %d, locality: %s, numa_write: [%s], baseline_gbps: %f, best_hint: %s, best_distance: %zu, best_gbps: %f, speedup: %f, payload: %zu.",
+            cpu_numa_id, mem_numa_id, locality, join(nlaw).c_str(),
+            baseline_gbps, best_hint, best_distance, best_gbps, best_gbps / baseline_gbps, payload_bytes);
+
+        hwloc_free(topology, buffer, payload_bytes);
+    }
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+template <int Hint>
+uint64_t dram_read_prefetch_hint(const char *ptr, size_t size, size_t distance)
+{
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    size_t i;
+
+    // One prefetch per cache line, issued `distance` bytes ahead of the loads.
+    // Prefetches past the end of the buffer are dropped by the hardware.
+    for (i = 0; i + CACHE_LINE_SIZE <= size; i += CACHE_LINE_SIZE)
+    {
+        if (distance)
+            _mm_prefetch(ptr + i + distance, (enum _mm_hint)Hint);
+
+        const uint64_t *words = (const uint64_t *)(ptr + i);
+        s0 += words[0] + words[1];
+        s1 += words[2] + words[3];
+        s2 += words[4] + words[5];
+        s3 += words[6] + words[7];
+    }
+
+    for (; i < size; i++)
+        s0 += ptr[i];
+
+    return s0 + s1 + s2 + s3;
+}
+
+// _mm_prefetch needs the hint as a compile-time constant.
+uint64_t dram_read_prefetch(const char *ptr, size_t size, size_t distance, int hint)
+{
+    switch (hint)
+    {
+        case _MM_HINT_T1: return dram_read_prefetch_hint<_MM_HINT_T1>(ptr, size, distance);
+        case _MM_HINT_T2: return dram_read_prefetch_hint<_MM_HINT_T2>(ptr, size, distance);
+        case _MM_HINT_NTA: return dram_read_prefetch_hint<_MM_HINT_NTA>(ptr, size, distance);
+        default: return dram_read_prefetch_hint<_MM_HINT_T0>(ptr, size, distance);
+    }
+}
+
+// Best read bandwidth out of several full passes over the buffer.
+double read_gbps(const char *buffer, size_t size, size_t distance, int hint, int repeats)
+{
+    double best_gbps = 0.0;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        uint64_t start = timer_ticks();
+        uint64_t checksum = dram_read_prefetch(buffer, size, distance, hint);
+        uint64_t end = timer_ticks();
+
+        // Keep the checksum alive so the reads are not optimized away.
+        volatile uint64_t sink = checksum;
+        (void)sink;
+
+        double gbps = size / ((end - start) / timer_ticks_per_ns());
+        best_gbps = std::max(best_gbps, gbps);
+    }
+
+    return best_gbps;
+}
@@ -0,0 +1,226 @@
+#include <hwloc.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <getopt.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+XBT_LOG_NEW_DEFAULT_CATEGORY(example, "example");
+
+#include "common.h"
+#include "timing.h"
+#include "dram_alloc.h"
+#include "latency.h"
+#include "checksum.h"
+
+#define MIN_BYTES 4ULL * 1024
+#define MAX_BYTES 4ULL * 1024 * 1024 * 1024
+#define LATENCY_MAX_BYTES 1ULL * 1024 * 1024 * 1024
+#define PASS_BYTES 256ULL * 1024 * 1024
+#define LATENCY_ACCESSES 2000000ULL
+#define STEPS_PER_DOUBLING 2
+
+struct working_set_point_s
+{
+    size_t size;
+    std::string level;
+    double write_gbps;
+    double read_gbps;
+    double latency_ns; // 0 when size is above the latency limit
+};
+typedef struct working_set_point_s working_set_point_t;
+
+std::vector<size_t> working_set_sizes(size_t min_bytes, size_t max_bytes, int steps);
+working_set_point_t working_set_measure(char *buffer, size_t size, size_t pass_bytes, size_t latency_max_bytes, size_t accesses, checksum_kernel_t checksum_read);
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [-c cpu_nodes] [-m mem_nodes] [-l min_bytes] [-u max_bytes] [-n steps] [-L latency_max_bytes] [-a accesses] [-o output_csv]\n"
+        "  -c  comma-separated NUMA nodes running the kernels (default: all nodes with cores)\n"
+        "  -m  comma-separated memory nodes (default: all nodes)\n"
+        "  -l  smallest working set in bytes (default: 4 KiB)\n"
+        "  -u  largest working set in bytes (default: 4 GiB)\n"
+        "  -n  sizes per doubling of the working set (default: 2)\n"
+        "  -L  largest working set whose latency is measured (default: 1 GiB)\n"
+        "  -a  dependent loads timed per size (default: 2000000)\n"
+        "  -o  also write every point to a CSV file\n",
+        program);
+}
+
+int main(int argc, char *argv[])
+{
+    // Initialize XBT logging system
+    xbt_log_init(&argc, argv);
+
+    std::string cpu_nodes;
+    std::string mem_nodes;
+    size_t min_bytes = MIN_BYTES;
+    size_t max_bytes = MAX_BYTES;
+    int steps = STEPS_PER_DOUBLING;
+    size_t latency_max_bytes = LATENCY_MAX_BYTES;
+    size_t accesses = LATENCY_ACCESSES;
+    std::string output_csv;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "c:m:l:u:n:L:a:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'c': cpu_nodes = optarg; break;
+            case 'm': mem_nodes = optarg; break;
+            case 'l': min_bytes = strtoull(optarg, NULL, 0); break;
+            case 'u': max_bytes = strtoull(optarg, NULL, 0); break;
+            case 'n': steps = atoi(optarg); break;
+            case 'L': latency_max_bytes = strtoull(optarg, NULL, 0); break;
+            case 'a': accesses = strtoull(optarg, NULL, 0); break;
+            case 'o': output_csv = optarg; break;
+            default: usage(argv[0]); exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    hwloc_topology_t topology;
+
+    // Runtime system status.
+    hwloc_topology_init(&topology);
+    hwloc_topology_load(topology);
+
+    FILE *csv = NULL;
+    if (!output_csv.empty())
+    {
+        csv = fopen(output_csv.c_str(), "w");
+        if (!csv)
+        {
+            XBT_ERROR("unable to open %s. errno: %d, error: %s", output_csv.c_str(), errno, strerror(errno));
+            hwloc_topology_destroy(topology);
+            exit(EXIT_FAILURE);
+        }
+        fprintf(csv, "cpu_numa_id,mem_numa_id,size,level,write_gbps,read_gbps,latency_ns\n");
+    }
+
+    checksum_kernel_t checksum_read = checksum_kernel_get(isa_best());
+    std::vector<size_t> sizes = working_set_sizes(min_bytes, max_bytes, steps);
+
+    for (int cpu_numa_id : numa_ids_get(topology, cpu_nodes))
+    {
+        std::vector<int> pus = cpu_pus_get(topology, "", cpu_numa_id);
+        if (pus.empty())
+        {
+            XBT_WARN("NUMA node %d has no cores (memory-only node), skipping.", cpu_numa_id);
+            continue;
+        }
+
+        // One core, so the working set competes for a single L1/L2.
+        thread_bind_to_pu(topology, pus[0]);
+
+        std::vector<cache_level_t> caches = cache_levels_get(topology, pus[0]);
+        std::vector<std::string> cache_sizes;
+        for (const cache_level_t &cache : caches)
+            cache_sizes.push_back("L" + std::to_string(cache.depth) + ": " + std::to_string(cache.size));
+        XBT_INFO("cpu_numa_id: %d, pu: %d, caches: {%s}.", cpu_numa_id, pus[0], join(cache_sizes, ", ").c_str());
+
+        for (int mem_numa_id : numa_ids_get(topology, mem_nodes))
+        {
+            // Huge pages, so the DRAM-sized latency points do not also take a
+            // DTLB miss and a page walk on nearly every load (see 7_pointer_chase.cpp).
+            dram_buffer_t dram_buffer = dram_buffer_alloc(topology, max_bytes, DRAM_BACKEND_THP, mem_numa_id);
+            char *buffer = dram_buffer.ptr;
+
+            if (!buffer)
+            {
+                XBT_ERROR("unable to create buffer on NUMA node %d. errno: %d, error: %s", mem_numa_id, errno, strerror(errno));
+                hwloc_topology_destroy(topology);
+                exit(EXIT_FAILURE);
+            }
+
+            // Fault every page in once so no size pays for page faults.
+            memset(buffer, 1, max_bytes);
+            std::vector<int> nlaw = thread_numa_get(topology, buffer, max_bytes);
+
+            dram_pages_t pages = dram_buffer_pages(dram_buffer);
+            if (pages.huge_bytes < max_bytes / 2)
+                XBT_WARN("buffer on NUMA node %d is backed by 4 KiB pages, the latency includes TLB misses.", mem_numa_id);
+
+            for (size_t size : sizes)
+            {
+                working_set_point_t point = working_set_measure(buffer, size, PASS_BYTES, latency_max_bytes, accesses, checksum_read);
+                point.level = cache_level_name(caches, size);
+
+                XBT_INFO("cpu_numa_id: %d, mem_numa_id: %d, numa_write: [%s], level: %s, write_gbps: %f, read_gbps: %f, latency_ns: %f, payload: %zu.",
+                    cpu_numa_id, mem_numa_id, join(nlaw).c_str(), point.level.c_str(),
+                    point.write_gbps, point.read_gbps, point.latency_ns, size);
+
+                if (csv)
+                    fprintf(csv, "%d,%d,%zu,%s,%f,%f,%f\n", cpu_numa_id, mem_numa_id, size, point.level.c_str(),
+                        point.write_gbps, point.read_gbps, point.latency_ns);
+            }
+
+            dram_buffer_free(dram_buffer);
+        }
+    }
+
+    if (csv)
+        fclose(csv);
+
+    hwloc_topology_destroy(topology);
+
+    return 0;
+}
+
+// Log-spaced sizes from min_bytes to max_bytes (both included), rounded to
+// cache lines, with `steps` sizes per doubling.
+std::vector<size_t> working_set_sizes(size_t min_bytes, size_t max_bytes, int steps)
+{
+    std::vector<size_t> sizes;
+    steps = std::max(steps, 1);
+
+    for (int i = 0;; i++)
+    {
+        size_t size = (size_t)(min_bytes * std::pow(2.0, (double)i / steps));
+        size = std::max((size_t)CACHE_LINE_SIZE, size / CACHE_LINE_SIZE * CACHE_LINE_SIZE);
+        if (size >= max_bytes)
+            break;
+        if (sizes.empty() || size != sizes.back())
+            sizes.push_back(size);
+    }
+    sizes.push_back(max_bytes);
+
+    return sizes;
+}
+
+// Write and read bandwidth over the first `size` bytes of the buffer, then
+// latency. Small sizes are swept several times so each measurement moves at
+// least pass_bytes and stays well above the timer resolution; one untimed
+// pass first brings the working set into the cache level it fits in.
+working_set_point_t working_set_measure(char *buffer, size_t size, size_t pass_bytes, size_t latency_max_bytes, size_t accesses, checksum_kernel_t checksum_read)
+{
+    working_set_point_t point = {size, "", 0.0, 0.0, 0.0};
+    size_t passes = std::max((size_t)1, pass_bytes / size);
+
+    memset(buffer, 0, size);
+    uint64_t start = timer_ticks();
+    for (size_t pass = 0; pass < passes; pass++)
+        memset(buffer, (int)pass, size);
+    uint64_t end = timer_ticks();
+    point.write_gbps = passes * size / ((end - start) / timer_ticks_per_ns());
+
+    uint64_t checksum = checksum_read(buffer, size);
+    start = timer_ticks();
+    for (size_t pass = 0; pass < passes; pass++)
+        checksum += checksum_read(buffer, size);
+    end = timer_ticks();
+    point.read_gbps = passes * size / ((end - start) / timer_ticks_per_ns());
+
+    // Keep the checksum alive so the reads are not optimized away.
+    volatile uint64_t sink = checksum;
+    (void)sink;
+
+    // The pointer chain overwrites the buffer, so it runs last.
+    if (size <= latency_max_bytes)
+        point.latency_ns = latency_chase_ns(buffer, size, accesses);
+
+    return point;
+}
@@ -0,0 +1,140 @@
+// Non-sequential access-pattern kernels.
+//
+// Every other kernel scans its buffer sequentially, the pattern the hardware
+// prefetchers predict best. These ones do not:
+//   - strided: one 64-byte line every `stride` bytes (stride 64 is the
+//     sequential baseline); the L2 streamer only follows strides within a
+//     4 KiB page,
+//   - random: one full 64-byte line at each offset of a uniform random index
+//     array; the loads are independent, unlike the pointer chase of
+//     latency.h, so several misses can be in flight,
+//   - gather: AVX-512 vpgatherqq/vpscatterqq over the same index array, one
+//     8-byte word in each of 8 random lines per instruction.
+// Read kernels return a sum of the loaded words so the loads are kept.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <immintrin.h>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstddef>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define ACCESS_WORDS_PER_LINE (CACHE_LINE_SIZE / sizeof(uint64_t))
+
+// Line-aligned offsets drawn uniformly from [0, size).
+inline std::vector<uint64_t> access_offsets_random(size_t size, size_t count, uint64_t seed=42)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint64_t> dist(0, size / CACHE_LINE_SIZE - 1);
+
+    std::vector<uint64_t> offsets(count);
+    for (size_t i = 0; i < count; i++)
+        offsets[i] = dist(rng) * CACHE_LINE_SIZE;
+
+    return offsets;
+}
+
+inline uint64_t access_line_read(const char *line)
+{
+    const uint64_t *words = (const uint64_t *)line;
+    uint64_t sum = 0;
+    for (size_t word = 0; word < ACCESS_WORDS_PER_LINE; word++)
+        sum += words[word];
+    return sum;
+}
+
+inline void access_line_write(char *line, uint64_t value)
+{
+    uint64_t *words = (uint64_t *)line;
+    for (size_t word = 0; word < ACCESS_WORDS_PER_LINE; word++)
+        words[word] = value;
+}
+
+// One line every stride bytes; returns the number of lines through *lines.
+inline uint64_t access_read_strided(const char *buffer, size_t size, size_t stride, size_t *lines)
+{
+    uint64_t sum = 0;
+    size_t count = 0;
+    for (size_t offset = 0; offset + CACHE_LINE_SIZE <= size; offset += stride, count++)
+        sum += access_line_read(buffer + offset);
+    *lines = count;
+    return sum;
+}
+
+inline size_t access_write_strided(char *buffer, size_t size, size_t stride, uint64_t value)
+{
+    size_t count = 0;
+    for (size_t offset = 0; offset + CACHE_LINE_SIZE <= size; offset += stride, count++)
+        access_line_write(buffer + offset, value);
+    return count;
+}
+
+inline uint64_t access_read_random(const char *buffer, const uint64_t *offsets, size_t count)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += access_line_read(buffer + offsets[i]);
+    return sum;
+}
+
+inline void access_write_random(char *buffer, const uint64_t *offsets, size_t count, uint64_t value)
+{
+    for (size_t i = 0; i < count; i++)
+        access_line_write(buffer + offsets[i], value);
+}
+
+// Masked form with a zero source: GCC 12 warns about the undefined source
+// register of the plain _mm512_i64gather_epi64.
+__attribute__((target("avx512f")))
+inline __m512i access_gather(__m512i index, const char *buffer)
+{
+    return _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xFF, index, (const void *)buffer, 1);
+}
+
+// count must be a multiple of 8.
+__attribute__((target("avx512f")))
+inline uint64_t access_read_gather(const char *buffer, const uint64_t *offsets, size_t count)
+{
+    __m512i sum0 = _mm512_setzero_si512();
+    __m512i sum1 = _mm512_setzero_si512();
+    size_t i = 0;
+
+    // Two independent gathers per iteration keep 16 lines in flight.
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512i index0 = _mm512_loadu_si512((const void *)(offsets + i));
+        __m512i index1 = _mm512_loadu_si512((const void *)(offsets + i + 8));
+        sum0 = _mm512_add_epi64(sum0, access_gather(index0, buffer));
+        sum1 = _mm512_add_epi64(sum1, access_gather(index1, buffer));
+    }
+    for (; i + 8 <= count; i += 8)
+    {
+        __m512i index = _mm512_loadu_si512((const void *)(offsets + i));
+        sum0 = _mm512_add_epi64(sum0, access_gather(index, buffer));
+    }
+
+    uint64_t lanes[8];
+    _mm512_storeu_si512((void *)lanes, _mm512_add_epi64(sum0, sum1));
+    uint64_t total = 0;
+    for (int lane = 0; lane < 8; lane++)
+        total += lanes[lane];
+    return total;
+}
+
+__attribute__((target("avx512f")))
+inline void access_write_scatter(char *buffer, const uint64_t *offsets, size_t count, uint64_t value)
+{
+    const __m512i v = _mm512_set1_epi64((long long)value);
+
+    for (size_t i = 0; i + 8 <= count; i += 8)
+    {
+        __m512i index = _mm512_loadu_si512((const void *)(offsets + i));
+        _mm512_i64scatter_epi64((void *)buffer, index, v, 1);
+    }
+}
@@ -0,0 +1,170 @@
+// Multi-threaded write/read bandwidth measurement over a shared buffer.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <pthread.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "common.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+struct bandwidth_worker_s
+{
+    int thread_id;
+    int pu_id;
+    bool bound;         // The thread runs on pu_id
+    bool located;       // nlaw (serial thread) and locality were read
+    char *slice;
+    size_t size;
+    double write_start_timestamp_us;
+    double write_end_timestamp_us;
+    double read_start_timestemp_us;
+    double read_end_timestemp_us;
+    uint64_t checksum;
+    thread_locality_t locality;
+};
+typedef struct bandwidth_worker_s bandwidth_worker_t;
+
+struct bandwidth_result_s
+{
+    double write_time_us;
+    double read_time_us;
+    uint64_t checksum;
+    bool bound;         // Every worker ran on its PU
+    bool located;       // nlaw and every worker's locality were read
+    std::vector<int> nlaw;
+    std::vector<bandwidth_worker_t> workers;
+};
+typedef struct bandwidth_result_s bandwidth_result_t;
+
+struct bandwidth_state_s
+{
+    hwloc_topology_t topology;
+    pthread_barrier_t barrier;
+    char *buffer;
+    size_t payload_bytes;
+    std::vector<int> nlaw;
+};
+typedef struct bandwidth_state_s bandwidth_state_t;
+
+// Sum the buffer in 64-bit words so a single thread is bound by memory, not by instruction throughput.
+inline uint64_t dram_read_sum(const char *ptr, size_t size)
+{
+    const uint64_t *words = (const uint64_t *)ptr;
+    uint64_t checksum = 0;
+    size_t i;
+
+    for (i = 0; i < size / sizeof(uint64_t); i++)
+        checksum += words[i];
+
+    for (i *= sizeof(uint64_t); i < size; i++)
+        checksum += ptr[i];
+
+    return checksum;
+}
+
+inline void bandwidth_worker_run(bandwidth_state_t *state, bandwidth_worker_t *worker)
+{
+    // An unbound worker still runs both phases so the barriers line up; the
+    // caller discards the result.
+    worker->bound = thread_try_bind_to_pu(state->topology, worker->pu_id);
+
+    // Write phase.
+    pthread_barrier_wait(&state->barrier);
+    worker->write_start_timestamp_us = get_time_us();
+
+    memset(worker->slice, 0, worker->size);
+
+    worker->write_end_timestamp_us = get_time_us();
+
+    // Get data locality after writing, once every slice has been touched.
+    // Like the binding, a failure is reported through a flag: an exception
+    // escaping the thread would call std::terminate.
+    worker->located = true;
+    if (pthread_barrier_wait(&state->barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+    {
+        try { state->nlaw = thread_numa_get(state->topology, state->buffer, state->payload_bytes); }
+        catch (const std::exception &) { worker->located = false; }
+    }
+
+    // Read phase.
+    pthread_barrier_wait(&state->barrier);
+    worker->read_start_timestemp_us = get_time_us();
+
+    worker->checksum = dram_read_sum(worker->slice, worker->size);
+
+    worker->read_end_timestemp_us = get_time_us();
+
+    try { worker->locality = thread_get_locality_from_os(state->topology); }
+    catch (const std::exception &) { worker->located = false; }
+}
+
+// Writes and then reads the buffer with one thread per PU. Each thread owns a
+// contiguous, cache-line aligned slice; the last one takes the remainder.
+inline bandwidth_result_t bandwidth_run(hwloc_topology_t topology, char *buffer, size_t payload_bytes, const std::vector<int> &pus)
+{
+    int num_threads = pus.size();
+    bandwidth_state_t state;
+    state.topology = topology;
+    state.buffer = buffer;
+    state.payload_bytes = payload_bytes;
+
+    bandwidth_result_t result;
+    result.workers.resize(num_threads);
+
+    size_t slice_bytes = (payload_bytes / num_threads) & ~((size_t)CACHE_LINE_SIZE - 1);
+    for (int i = 0; i < num_threads; i++)
+    {
+        bandwidth_worker_t &worker = result.workers[i];
+        worker.thread_id = i;
+        worker.pu_id = pus[i];
+        worker.slice = buffer + i * slice_bytes;
+        worker.size = (i == num_threads - 1) ? payload_bytes - i * slice_bytes : slice_bytes;
+    }
+
+    // Workers wait on each other so that every phase starts at the same time on all cores.
+    pthread_barrier_init(&state.barrier, NULL, num_threads);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++)
+        threads.emplace_back(bandwidth_worker_run, &state, &result.workers[i]);
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    pthread_barrier_destroy(&state.barrier);
+
+    // Aggregate time of a phase spans from the first thread starting to the last one finishing.
+    double write_start_timestamp_us = result.workers[0].write_start_timestamp_us;
+    double write_end_timestamp_us = result.workers[0].write_end_timestamp_us;
+    double read_start_timestemp_us = result.workers[0].read_start_timestemp_us;
+    double read_end_timestemp_us = result.workers[0].read_end_timestemp_us;
+    result.checksum = 0;
+    result.bound = true;
+    result.located = true;
+    for (const bandwidth_worker_t &worker : result.workers)
+    {
+        result.bound = result.bound && worker.bound;
+        result.located = result.located && worker.located;
+        write_start_timestamp_us = std::min(write_start_timestamp_us, worker.write_start_timestamp_us);
+        write_end_timestamp_us = std::max(write_end_timestamp_us, worker.write_end_timestamp_us);
+        read_start_timestemp_us = std::min(read_start_timestemp_us, worker.read_start_timestemp_us);
+        read_end_timestemp_us = std::max(read_end_timestemp_us, worker.read_end_timestemp_us);
+        result.checksum += worker.checksum;
+    }
+
+    result.write_time_us = write_end_timestamp_us - write_start_timestamp_us;
+    result.read_time_us = read_end_timestemp_us - read_start_timestemp_us;
+    result.nlaw = state.nlaw;
+
+    return result;
+}
@@ -0,0 +1,354 @@
+// Helpers shared by the prefetcher benchmarks.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY so the logging
+// macros used below resolve to the category of the including program.
+#pragma once
+
+#include <hwloc.h>
+#include <sys/time.h>
+#include <xbt/log.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <sys/resource.h> // For getrusage
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#define PAGE_SIZE_4K 4096
+
+struct thread_locality_s
+{
+    int numa_id;
+    int core_id;
+    long voluntary_context_switches;
+    long involuntary_context_switches;
+    long core_migrations;
+};
+typedef struct thread_locality_s thread_locality_t;
+
+inline double get_time_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+template <typename T>
+inline std::string join(const std::vector<T> &vec, const std::string &delimiter=",")
+{
+    std::ostringstream oss;
+
+    for (size_t i = 0; i < vec.size(); ++i)
+    {
+        oss << vec[i];
+        if (i != vec.size() - 1)
+        { // Avoid adding a delimiter after the last element
+            oss << delimiter;
+        }
+    }
+
+    return oss.str();
+}
+
+// Splits a comma-separated command-line list ("64,4096,8192") into its items.
+inline std::vector<std::string> list_split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream iss(list);
+    std::string token;
+    while (std::getline(iss, token, ','))
+        items.push_back(token);
+    return items;
+}
+
+inline std::vector<int> thread_numa_get(hwloc_topology_t topology, char *address, size_t size)
+{
+    /* Get data locality (NUMA nodes were data pages are allocated) */
+    hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+    std::vector<int> numa_nodes;
+
+    if (hwloc_get_area_memlocation(topology, address, size, nodeset, HWLOC_MEMBIND_BYNODESET) != 0)
+    {
+        XBT_ERROR("failed to retrieve memory binding for address: %p", address);
+        hwloc_bitmap_free(nodeset);
+        throw std::runtime_error("failed to retrieve memory binding for address.");
+    }
+
+    int node;
+    hwloc_bitmap_foreach_begin(node, nodeset)
+    {
+        numa_nodes.push_back(node); // Add NUMA node ID to the vector
+    }
+    hwloc_bitmap_foreach_end();
+
+    // Cleanup
+    hwloc_bitmap_free(nodeset);
+
+    return numa_nodes;
+}
+
+// Times the calling thread was moved to another CPU, from the
+// se.nr_migrations line of /proc/thread-self/sched (0 if the line is missing).
+inline long sched_migrations_get()
+{
+    std::ifstream sched_file("/proc/thread-self/sched");
+
+    if (!sched_file.is_open()) {
+        XBT_ERROR("failed to open /proc/thread-self/sched: %s", strerror(errno));
+        throw std::runtime_error("failed to open process scheduling information.");
+    }
+
+    // The line reads "se.nr_migrations   :   N".
+    std::string line;
+    long core_migrations = 0;
+    while (std::getline(sched_file, line))
+    {
+        if (line.find("nr_migrations") != std::string::npos)
+        {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos)
+                core_migrations = strtol(line.c_str() + colon + 1, NULL, 10);
+            break;
+        }
+    }
+
+    return core_migrations;
+}
+
+inline thread_locality_t thread_get_locality_from_os(hwloc_topology_t topology)
+{
+    // Get the current thread's CPU binding
+    hwloc_bitmap_t cpuset = hwloc_bitmap_alloc();
+    hwloc_get_last_cpu_location(topology, cpuset, HWLOC_CPUBIND_THREAD);
+
+    // Get the NUMA node on which the current thread is running
+    hwloc_bitmap_t nodeset = hwloc_bitmap_alloc();
+    hwloc_cpuset_to_nodeset(topology, cpuset, nodeset);
+
+    int numa_id = hwloc_bitmap_first(nodeset); // Get the first NUMA node
+
+    // Get the core object corresponding to the CPU binding
+    hwloc_obj_t obj = hwloc_get_obj_covering_cpuset(topology, cpuset);
+
+    // Cleanup
+    hwloc_bitmap_free(cpuset);
+    hwloc_bitmap_free(nodeset);
+
+    // Traverse up the object hierarchy to find the core object
+    while (obj && obj->type != HWLOC_OBJ_CORE) obj = obj->parent;
+
+    if (!obj)
+    {
+        XBT_ERROR("failed to get core object.");
+        throw std::runtime_error("failed to get core object.");
+    }
+
+    int core_id = obj->logical_index; // Get the logical core ID
+
+    // Retrieve core migration information from /proc/thread-self/sched
+    long core_migrations = sched_migrations_get();
+
+    // Get context switch information using getrusage
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    // Return locality and context switch information along with core migrations
+    return {numa_id, core_id, usage.ru_nvcsw, usage.ru_nivcsw, core_migrations};
+}
+
+// Returns the hwloc nodeset holding only the NUMA node with the given OS index.
+// The caller owns the returned bitmap.
+inline hwloc_nodeset_t numa_nodeset_get(hwloc_topology_t topology, int numa_id)
+{
+    hwloc_obj_t node = hwloc_get_numanode_obj_by_os_index(topology, numa_id);
+
+    if (!node)
+    {
+        XBT_ERROR("NUMA node %d does not exist in this topology.", numa_id);
+        throw std::runtime_error("invalid NUMA node id.");
+    }
+
+    return hwloc_bitmap_dup(node->nodeset);
+}
+
+// Parses a comma-separated list of NUMA node OS indexes; an empty list
+// selects every NUMA node of the topology.
+inline std::vector<int> numa_ids_get(hwloc_topology_t topology, const std::string &list)
+{
+    std::vector<int> numa_ids;
+
+    if (list.empty())
+    {
+        hwloc_obj_t node = NULL;
+        while ((node = hwloc_get_next_obj_by_type(topology, HWLOC_OBJ_NUMANODE, node)) != NULL)
+            numa_ids.push_back(node->os_index);
+        return numa_ids;
+    }
+
+    std::istringstream iss(list);
+    std::string token;
+    while (std::getline(iss, token, ','))
+        numa_ids.push_back(atoi(token.c_str()));
+
+    return numa_ids;
+}
+
+// Returns the PUs usable by the benchmark threads: the PUs set in a
+// core_avail_mask string (taskset format, e.g. "0xF00000F") or, when the mask
+// is empty, the first PU of each core attached to the given NUMA node.
+inline std::vector<int> cpu_pus_get(hwloc_topology_t topology, const std::string &core_avail_mask, int numa_id)
+{
+    std::vector<int> pus;
+
+    if (!core_avail_mask.empty())
+    {
+        hwloc_bitmap_t mask = hwloc_bitmap_alloc();
+        if (hwloc_bitmap_taskset_sscanf(mask, core_avail_mask.c_str()) != 0)
+        {
+            hwloc_bitmap_free(mask);
+            XBT_ERROR("invalid core_avail_mask: %s", core_avail_mask.c_str());
+            throw std::runtime_error("invalid core_avail_mask.");
+        }
+
+        int pu;
+        hwloc_bitmap_foreach_begin(pu, mask)
+        {
+            if (hwloc_get_pu_obj_by_os_index(topology, pu))
+                pus.push_back(pu);
+            else
+                XBT_WARN("core_avail_mask bit %d has no PU in this topology, skipping.", pu);
+        }
+        hwloc_bitmap_foreach_end();
+
+        hwloc_bitmap_free(mask);
+        return pus;
+    }
+
+    hwloc_obj_t node = hwloc_get_numanode_obj_by_os_index(topology, numa_id);
+    if (!node)
+    {
+        XBT_ERROR("NUMA node %d does not exist in this topology.", numa_id);
+        throw std::runtime_error("invalid NUMA node id.");
+    }
+
+    hwloc_obj_t core = NULL;
+    while ((core = hwloc_get_next_obj_inside_cpuset_by_type(topology, node->cpuset, HWLOC_OBJ_CORE, core)) != NULL)
+    {
+        hwloc_obj_t pu = hwloc_get_obj_inside_cpuset_by_type(topology, core->cpuset, HWLOC_OBJ_PU, 0);
+        if (pu)
+            pus.push_back(pu->os_index);
+    }
+
+    return pus;
+}
+
+struct cache_level_s
+{
+    unsigned depth; // 1 for L1, 2 for L2, ...
+    size_t size;    // Bytes, shared by every PU below the cache
+};
+typedef struct cache_level_s cache_level_t;
+
+// Data (or unified) caches above a PU, from L1 outwards.
+inline std::vector<cache_level_t> cache_levels_get(hwloc_topology_t topology, int pu_id)
+{
+    std::vector<cache_level_t> levels;
+
+    hwloc_obj_t obj = hwloc_get_pu_obj_by_os_index(topology, pu_id);
+    for (; obj; obj = obj->parent)
+    {
+        if (hwloc_obj_type_is_dcache(obj->type))
+            levels.push_back({obj->attr->cache.depth, (size_t)obj->attr->cache.size});
+    }
+
+    return levels;
+}
+
+// Name of the smallest cache level holding size bytes, "DRAM" if none does.
+inline std::string cache_level_name(const std::vector<cache_level_t> &levels, size_t size)
+{
+    for (const cache_level_t &level : levels)
+        if (size <= level.size)
+            return "L" + std::to_string(level.depth);
+
+    return "DRAM";
+}
+
+// Binds the calling thread to a single PU (OS index). Returns false after
+// logging the error; worker threads use this form, since an exception
+// escaping a std::thread calls std::terminate, and report the failure
+// through a flag the caller checks after join().
+inline bool thread_try_bind_to_pu(hwloc_topology_t topology, int pu_id)
+{
+    hwloc_obj_t pu = hwloc_get_pu_obj_by_os_index(topology, pu_id);
+
+    if (!pu || hwloc_set_cpubind(topology, pu->cpuset, HWLOC_CPUBIND_THREAD) != 0)
+    {
+        XBT_ERROR("unable to bind thread to PU %d. errno: %d, error: %s", pu_id, errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Same for the main thread, which throws.
+inline void thread_bind_to_pu(hwloc_topology_t topology, int pu_id)
+{
+    if (!thread_try_bind_to_pu(topology, pu_id))
+        throw std::runtime_error("failed to bind thread to PU.");
+}
+
+// Write a square matrix the way the templates' distance_matrices expect it:
+// the number of nodes on the first line followed by one row per line.
+inline void matrix_write(const std::string &path, const std::vector<std::vector<double>> &matrix, const char *format)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        XBT_ERROR("unable to open %s. errno: %d, error: %s", path.c_str(), errno, strerror(errno));
+        throw std::runtime_error("failed to write distance matrix.");
+    }
+
+    fprintf(file, "%zu", matrix.size());
+    for (const std::vector<double> &row : matrix)
+    {
+        fprintf(file, "\n");
+        for (size_t j = 0; j < row.size(); j++)
+        {
+            if (j > 0)
+                fprintf(file, " ");
+            fprintf(file, format, row[j]);
+        }
+    }
+
+    fclose(file);
+    XBT_INFO("distance matrix written to %s", path.c_str());
+}
+
+// Read a distance matrix written in the format above (e.g. system/non_uniform_lat.txt).
+inline std::vector<std::vector<double>> matrix_read(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        XBT_ERROR("unable to open %s. errno: %d, error: %s", path.c_str(), errno, strerror(errno));
+        throw std::runtime_error("failed to read distance matrix.");
+    }
+
+    size_t num_nodes = 0;
+    file >> num_nodes;
+
+    std::vector<std::vector<double>> matrix(num_nodes, std::vector<double>(num_nodes, 0.0));
+    for (size_t i = 0; i < num_nodes; i++)
+        for (size_t j = 0; j < num_nodes; j++)
+            if (!(file >> matrix[i][j]))
+            {
+                XBT_ERROR("distance matrix %s is truncated at row %zu, column %zu.", path.c_str(), i, j);
+                throw std::runtime_error("malformed distance matrix.");
+            }
+
+    return matrix;
+}
@@ -0,0 +1,164 @@
+// Bulk copy engine for inter-NUMA transfers.
+//
+// Moves one task's output to the node of the task consuming it with one of:
+//   - memcpy: glibc, which picks its own vector width and switches to
+//     non-temporal stores above a size threshold,
+//   - rep-movsb: the string instruction, fast on CPUs with ERMSB/FSRM,
+//   - avx512-nt: 64-byte loads and non-temporal stores (the path of the
+//     streaming kernels). The stores bypass the caches of the destination;
+//     the loads use movntdqa, which on write-back memory Intel CPUs execute
+//     as normal cached loads, so the source still goes through the caches,
+//   - threaded: the range split into page-aligned slices copied in parallel
+//     by threads pinned to the given PUs, each with avx512-nt when the CPU
+//     supports it and memcpy otherwise.
+// The threads are created per copy, as in bandwidth.h; at 4e7-1e8 bytes the
+// creation cost is small next to the copy itself.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <hwloc.h>
+#include <immintrin.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+#include "common.h"
+#include "isa.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+enum copy_strategy_e
+{
+    COPY_MEMCPY,
+    COPY_REP_MOVSB,
+    COPY_AVX512_NT,
+    COPY_THREADED,
+};
+typedef enum copy_strategy_e copy_strategy_t;
+
+static const copy_strategy_t COPY_STRATEGIES[] = {COPY_MEMCPY, COPY_REP_MOVSB, COPY_AVX512_NT, COPY_THREADED};
+
+struct copy_engine_s
+{
+    copy_strategy_t strategy;
+    hwloc_topology_t topology;
+    std::vector<int> pus; // Threads of the threaded strategy, one per PU
+};
+typedef struct copy_engine_s copy_engine_t;
+
+inline const char *copy_strategy_name(copy_strategy_t strategy)
+{
+    switch (strategy)
+    {
+        case COPY_REP_MOVSB: return "rep-movsb";
+        case COPY_AVX512_NT: return "avx512-nt";
+        case COPY_THREADED: return "threaded";
+        default: return "memcpy";
+    }
+}
+
+inline copy_strategy_t copy_strategy_parse(const std::string &name)
+{
+    for (copy_strategy_t strategy : COPY_STRATEGIES)
+        if (name == copy_strategy_name(strategy))
+            return strategy;
+
+    XBT_ERROR("unknown copy strategy: %s (expected memcpy, rep-movsb, avx512-nt or threaded)", name.c_str());
+    throw std::runtime_error("unknown copy strategy.");
+}
+
+inline bool copy_strategy_supported(copy_strategy_t strategy)
+{
+    return strategy != COPY_AVX512_NT || isa_supported(ISA_AVX512);
+}
+
+inline void copy_rep_movsb(char *dest, const char *src, size_t size)
+{
+    asm volatile("rep movsb" : "+D"(dest), "+S"(src), "+c"(size) : : "memory");
+}
+
+// dest is aligned with a short memcpy first; the loads use movntdqa only when
+// src ends up aligned too (a hint, ignored on write-back memory).
+__attribute__((target("avx512f")))
+inline void copy_avx512_nt(char *dest, const char *src, size_t size)
+{
+    size_t head = (CACHE_LINE_SIZE - (uintptr_t)dest % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
+    head = std::min(head, size);
+    memcpy(dest, src, head);
+
+    size_t i = head;
+    bool aligned = (uintptr_t)(src + i) % CACHE_LINE_SIZE == 0;
+
+    for (; i + 4 * CACHE_LINE_SIZE <= size; i += 4 * CACHE_LINE_SIZE)
+    {
+        __m512i v[4];
+        for (int u = 0; u < 4; u++)
+            v[u] = aligned ? _mm512_stream_load_si512((void *)(src + i + u * CACHE_LINE_SIZE))
+                           : _mm512_loadu_si512((const void *)(src + i + u * CACHE_LINE_SIZE));
+        for (int u = 0; u < 4; u++)
+            _mm512_stream_si512((__m512i *)(dest + i + u * CACHE_LINE_SIZE), v[u]);
+    }
+    for (; i + CACHE_LINE_SIZE <= size; i += CACHE_LINE_SIZE)
+    {
+        __m512i v = aligned ? _mm512_stream_load_si512((void *)(src + i)) : _mm512_loadu_si512((const void *)(src + i));
+        _mm512_stream_si512((__m512i *)(dest + i), v);
+    }
+
+    _mm_sfence();
+    memcpy(dest + i, src + i, size - i);
+}
+
+// Returns false if a thread could not be bound to its PU; the copy is still
+// complete, but its timing is not the one asked for.
+inline bool copy_threaded(const copy_engine_t &engine, char *dest, const char *src, size_t size)
+{
+    size_t threads = std::max(engine.pus.size(), (size_t)1);
+    size_t slice = (size / threads + PAGE_SIZE_4K - 1) / PAGE_SIZE_4K * PAGE_SIZE_4K;
+    bool nt = isa_supported(ISA_AVX512);
+    std::atomic<bool> unbound(false);
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++)
+    {
+        size_t offset = t * slice;
+        if (offset >= size)
+            break;
+        size_t length = std::min(slice, size - offset);
+        int pu = engine.pus.empty() ? -1 : engine.pus[t];
+
+        workers.emplace_back([&engine, &unbound, dest, src, offset, length, pu, nt]() {
+            if (pu >= 0 && !thread_try_bind_to_pu(engine.topology, pu))
+                unbound = true;
+            if (nt)
+                copy_avx512_nt(dest + offset, src + offset, length);
+            else
+                memcpy(dest + offset, src + offset, length);
+        });
+    }
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    return !unbound;
+}
+
+// Returns false if the threaded strategy could not bind its threads.
+inline bool copy_run(const copy_engine_t &engine, char *dest, const char *src, size_t size)
+{
+    switch (engine.strategy)
+    {
+        case COPY_REP_MOVSB: copy_rep_movsb(dest, src, size); break;
+        case COPY_AVX512_NT: copy_avx512_nt(dest, src, size); break;
+        case COPY_THREADED: return copy_threaded(engine, dest, src, size);
+        default: memcpy(dest, src, size); break;
+    }
+    return true;
+}
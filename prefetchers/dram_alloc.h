@@ -0,0 +1,214 @@
+// NUMA-bound buffer allocation with selectable page sizes.
+//
+// Backends:
+//   pages       regular 4 KiB pages
+//   thp         2 MiB aligned mapping with madvise(MADV_HUGEPAGE)
+//   hugetlb-2m  MAP_HUGETLB with 2 MiB pages (needs vm.nr_hugepages)
+//   hugetlb-1g  MAP_HUGETLB with 1 GiB pages (needs reserved 1 GiB pages)
+//
+// A 4 GiB scan over 4 KiB pages also measures about a million TLB misses and
+// page walks; comparing backends separates that cost from the DRAM cost. The
+// page size actually obtained is read back from /proc/self/smaps, since THP
+// is best effort and may silently fall back to small pages.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <sys/mman.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+#include "mem_policy.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+#define PAGE_SIZE_2M (2ULL * 1024 * 1024)
+#define PAGE_SIZE_1G (1024ULL * 1024 * 1024)
+
+enum dram_backend_e
+{
+    DRAM_BACKEND_PAGES,
+    DRAM_BACKEND_THP,
+    DRAM_BACKEND_HUGETLB_2M,
+    DRAM_BACKEND_HUGETLB_1G,
+};
+typedef enum dram_backend_e dram_backend_t;
+
+struct dram_buffer_s
+{
+    char *ptr;          // Start of the usable buffer
+    size_t size;        // Requested size
+    void *mapping;      // Start of the mapping (differs from ptr for thp)
+    size_t mapped_size; // Size of the mapping
+    dram_backend_t backend;
+};
+typedef struct dram_buffer_s dram_buffer_t;
+
+struct dram_pages_s
+{
+    size_t kernel_page_size; // KernelPageSize of the mapping
+    size_t huge_bytes;       // Bytes backed by transparent or hugetlb huge pages
+};
+typedef struct dram_pages_s dram_pages_t;
+
+inline const char *dram_backend_name(dram_backend_t backend)
+{
+    switch (backend)
+    {
+        case DRAM_BACKEND_THP: return "thp";
+        case DRAM_BACKEND_HUGETLB_2M: return "hugetlb-2m";
+        case DRAM_BACKEND_HUGETLB_1G: return "hugetlb-1g";
+        default: return "pages";
+    }
+}
+
+inline dram_backend_t dram_backend_parse(const std::string &name)
+{
+    if (name == "pages") return DRAM_BACKEND_PAGES;
+    if (name == "thp") return DRAM_BACKEND_THP;
+    if (name == "hugetlb-2m") return DRAM_BACKEND_HUGETLB_2M;
+    if (name == "hugetlb-1g") return DRAM_BACKEND_HUGETLB_1G;
+
+    XBT_ERROR("unknown allocation backend: %s (expected pages, thp, hugetlb-2m or hugetlb-1g)", name.c_str());
+    throw std::runtime_error("unknown allocation backend.");
+}
+
+inline size_t round_up(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Maps a buffer with the given backend and applies the memory policy before
+// the benchmark touches it. Returns a buffer with a NULL ptr on failure
+// (errno is preserved).
+inline dram_buffer_t dram_buffer_alloc(hwloc_topology_t topology, size_t size, dram_backend_t backend, const mem_policy_t &policy)
+{
+    dram_buffer_t buffer = {NULL, size, NULL, 0, backend};
+    // No MAP_NORESERVE: without reserved huge pages mmap must fail here
+    // rather than raise SIGBUS on first touch.
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    switch (backend)
+    {
+        case DRAM_BACKEND_THP:
+            // Over-allocate so the buffer can start on a 2 MiB boundary.
+            buffer.mapped_size = round_up(size, PAGE_SIZE_2M) + PAGE_SIZE_2M;
+            break;
+        case DRAM_BACKEND_HUGETLB_2M:
+            buffer.mapped_size = round_up(size, PAGE_SIZE_2M);
+            flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+            break;
+        case DRAM_BACKEND_HUGETLB_1G:
+            buffer.mapped_size = round_up(size, PAGE_SIZE_1G);
+            flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+            break;
+        default:
+            buffer.mapped_size = round_up(size, PAGE_SIZE_4K);
+            break;
+    }
+
+    void *mapping = mmap(NULL, buffer.mapped_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        XBT_ERROR("unable to map %zu bytes with backend %s. errno: %d, error: %s",
+            buffer.mapped_size, dram_backend_name(backend), errno, strerror(errno));
+        return buffer;
+    }
+
+    buffer.mapping = mapping;
+    buffer.ptr = (char *)mapping;
+
+    if (backend == DRAM_BACKEND_THP)
+    {
+        buffer.ptr = (char *)round_up((uintptr_t)mapping, PAGE_SIZE_2M);
+        if (madvise(buffer.ptr, round_up(size, PAGE_SIZE_2M), MADV_HUGEPAGE) != 0)
+            XBT_WARN("madvise(MADV_HUGEPAGE) failed, THP may be disabled. errno: %d, error: %s", errno, strerror(errno));
+    }
+
+    if (mem_policy_apply(topology, (char *)buffer.mapping, buffer.mapped_size, policy) != 0)
+    {
+        int error = errno;
+        munmap(buffer.mapping, buffer.mapped_size);
+        buffer.ptr = NULL;
+        buffer.mapping = NULL;
+        errno = error;
+    }
+
+    return buffer;
+}
+
+// Binds the buffer to numa_id, or leaves placement to the default policy
+// when numa_id is negative.
+inline dram_buffer_t dram_buffer_alloc(hwloc_topology_t topology, size_t size, dram_backend_t backend, int numa_id=-1)
+{
+    mem_policy_t policy = numa_id >= 0 ? mem_policy_bind(numa_id) : mem_policy_t{MEM_POLICY_DEFAULT, {}};
+    return dram_buffer_alloc(topology, size, backend, policy);
+}
+
+inline void dram_buffer_free(dram_buffer_t &buffer)
+{
+    if (buffer.mapping)
+        munmap(buffer.mapping, buffer.mapped_size);
+
+    buffer.ptr = NULL;
+    buffer.mapping = NULL;
+}
+
+// Reads the page size and the huge-page backed bytes of the mapping holding
+// the buffer from /proc/self/smaps. Only meaningful once the pages are touched.
+inline dram_pages_t dram_buffer_pages(const dram_buffer_t &buffer)
+{
+    dram_pages_t pages = {0, 0};
+    std::ifstream smaps("/proc/self/smaps");
+
+    if (!smaps.is_open())
+    {
+        XBT_WARN("failed to open /proc/self/smaps: %s", strerror(errno));
+        return pages;
+    }
+
+    uintptr_t address = (uintptr_t)buffer.ptr;
+    bool in_mapping = false;
+    std::string line;
+
+    while (std::getline(smaps, line))
+    {
+        uintptr_t start, end;
+        if (sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2)
+        {
+            // Header lines look like "7f...-7f... rw-p ..."; stop after our mapping.
+            if (in_mapping)
+                break;
+            in_mapping = address >= start && address < end;
+            continue;
+        }
+
+        if (!in_mapping)
+            continue;
+
+        std::istringstream iss(line);
+        std::string label;
+        size_t kb = 0;
+        iss >> label >> kb;
+
+        if (label == "KernelPageSize:")
+            pages.kernel_page_size = kb * 1024;
+        else if (label == "AnonHugePages:" || label == "Private_Hugetlb:" || label == "Shared_Hugetlb:")
+            pages.huge_bytes += kb * 1024;
+    }
+
+    return pages;
+}
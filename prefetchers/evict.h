@@ -0,0 +1,191 @@
+// Cache eviction before cold-read measurements.
+//
+// Runs between the write and read phases, outside the timed regions, so a
+// read phase starts with its buffer out of the caches. Methods:
+//   - clflush: the legacy instruction, serialized against every other
+//     clflush, one mfence at the end of each batch,
+//   - clflushopt: the weakly ordered flush, `batch_lines` lines in flight
+//     and one sfence per batch,
+//   - clwb: write back dirty lines like clflushopt, but the CPU may keep the
+//     line cached (Ice Lake and later do), so reads need not be cold,
+//   - thrash: read a buffer twice the size of the largest cache above the
+//     PU. The cost does not grow with the buffer to evict, but only the
+//     caches of that PU are cleared and replacement is only mostly LRU.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <hwloc.h>
+#include <immintrin.h>
+#include <cpuid.h>
+#include <sched.h>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+#include "timing.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+#define EVICT_BATCH_LINES 4096
+#define EVICT_THRASH_FALLBACK (64ULL * 1024 * 1024) // Without cache information
+
+enum evict_method_e
+{
+    EVICT_CLFLUSH,
+    EVICT_CLFLUSHOPT,
+    EVICT_CLWB,
+    EVICT_THRASH,
+};
+typedef enum evict_method_e evict_method_t;
+
+struct evict_s
+{
+    evict_method_t method;
+    size_t batch_lines;       // Lines flushed between two fences
+    hwloc_topology_t topology;
+    char *thrash;             // thrash only
+    size_t thrash_size;
+};
+typedef struct evict_s evict_t;
+
+inline const char *evict_method_name(evict_method_t method)
+{
+    switch (method)
+    {
+        case EVICT_CLFLUSHOPT: return "clflushopt";
+        case EVICT_CLWB: return "clwb";
+        case EVICT_THRASH: return "thrash";
+        default: return "clflush";
+    }
+}
+
+inline evict_method_t evict_method_parse(const std::string &name)
+{
+    if (name == "clflush") return EVICT_CLFLUSH;
+    if (name == "clflushopt") return EVICT_CLFLUSHOPT;
+    if (name == "clwb") return EVICT_CLWB;
+    if (name == "thrash") return EVICT_THRASH;
+
+    XBT_ERROR("unknown eviction method: %s (expected clflush, clflushopt, clwb or thrash)", name.c_str());
+    throw std::runtime_error("unknown eviction method.");
+}
+
+// CPUID.(EAX=7,ECX=0):EBX bit 23 is CLFLUSHOPT, bit 24 CLWB.
+inline bool evict_method_supported(evict_method_t method)
+{
+    if (method == EVICT_CLFLUSH || method == EVICT_THRASH)
+        return true;
+
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return false;
+    return method == EVICT_CLFLUSHOPT ? (ebx >> 23) & 1 : (ebx >> 24) & 1;
+}
+
+inline evict_method_t evict_method_best()
+{
+    return evict_method_supported(EVICT_CLFLUSHOPT) ? EVICT_CLFLUSHOPT : EVICT_CLFLUSH;
+}
+
+inline void evict_batch_clflush(const char *begin, const char *end)
+{
+    for (const char *p = begin; p < end; p += CACHE_LINE_SIZE)
+        _mm_clflush(p);
+    _mm_mfence();
+}
+
+__attribute__((target("clflushopt")))
+inline void evict_batch_clflushopt(const char *begin, const char *end)
+{
+    for (const char *p = begin; p < end; p += CACHE_LINE_SIZE)
+        _mm_clflushopt((void *)p);
+    _mm_sfence();
+}
+
+__attribute__((target("clwb")))
+inline void evict_batch_clwb(const char *begin, const char *end)
+{
+    for (const char *p = begin; p < end; p += CACHE_LINE_SIZE)
+        _mm_clwb((void *)p);
+    _mm_sfence();
+}
+
+// The thrash buffer is sized from the caches of pu_id (the calling thread's
+// current PU when negative) and faulted in here. Returns an evictor with a
+// NULL thrash buffer if it cannot be allocated.
+inline evict_t evict_open(hwloc_topology_t topology, evict_method_t method, size_t batch_lines=EVICT_BATCH_LINES, int pu_id=-1)
+{
+    evict_t evict = {method, std::max(batch_lines, (size_t)1), topology, NULL, 0};
+    if (method != EVICT_THRASH)
+        return evict;
+
+    size_t largest = 0;
+    for (const cache_level_t &level : cache_levels_get(topology, pu_id >= 0 ? pu_id : sched_getcpu()))
+        largest = std::max(largest, level.size);
+    evict.thrash_size = largest ? 2 * largest : EVICT_THRASH_FALLBACK;
+
+    evict.thrash = (char *)hwloc_alloc(topology, evict.thrash_size);
+    if (!evict.thrash)
+        XBT_ERROR("unable to create a %zu-byte thrash buffer. errno: %d, error: %s", evict.thrash_size, errno, strerror(errno));
+    else
+        memset(evict.thrash, 1, evict.thrash_size);
+
+    return evict;
+}
+
+inline void evict_close(evict_t &evict)
+{
+    if (evict.thrash)
+        hwloc_free(evict.topology, evict.thrash, evict.thrash_size);
+    evict.thrash = NULL;
+}
+
+// Evicts [buffer, buffer + size) and returns the time it took in us.
+inline double evict_run(const evict_t &evict, const char *buffer, size_t size)
+{
+    uint64_t start = timer_ticks();
+
+    if (evict.method == EVICT_THRASH)
+    {
+        uint64_t sum = 0;
+        for (size_t offset = 0; evict.thrash && offset < evict.thrash_size; offset += CACHE_LINE_SIZE)
+            sum += *(const uint64_t *)(evict.thrash + offset);
+
+        // Keep the sum alive so the loads are not optimized away.
+        volatile uint64_t sink = sum;
+        (void)sink;
+    }
+    else
+    {
+        const char *first = (const char *)((uintptr_t)buffer & ~(uintptr_t)(CACHE_LINE_SIZE - 1));
+        const char *end = buffer + size;
+        size_t batch_bytes = evict.batch_lines * CACHE_LINE_SIZE;
+
+        for (const char *begin = first; begin < end; begin += batch_bytes)
+        {
+            const char *batch_end = begin + std::min(batch_bytes, (size_t)(end - begin));
+            switch (evict.method)
+            {
+                case EVICT_CLFLUSHOPT: evict_batch_clflushopt(begin, batch_end); break;
+                case EVICT_CLWB: evict_batch_clwb(begin, batch_end); break;
+                default: evict_batch_clflush(begin, batch_end); break;
+            }
+        }
+    }
+
+    return (timer_ticks() - start) / timer_ticks_per_ns() / 1e3;
+}
+
+inline std::string evict_str(const evict_t &evict)
+{
+    if (evict.method == EVICT_THRASH)
+        return std::string("thrash:") + std::to_string(evict.thrash_size);
+    return std::string(evict_method_name(evict.method)) + ":" + std::to_string(evict.batch_lines);
+}
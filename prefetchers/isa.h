@@ -0,0 +1,66 @@
+// Instruction set variants of the streaming kernels.
+//
+// The kernels are compiled once per ISA with __attribute__((target(...))), so
+// a plain `g++` without -march still contains the AVX2 and AVX-512 code paths.
+// isa_best() asks cpuid (through __builtin_cpu_supports) for the widest
+// variant the running CPU executes; a variant can also be forced by name to
+// compare vector widths on the same node.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+enum isa_e
+{
+    ISA_SCALAR,  // 8-byte general purpose loads and stores
+    ISA_SSE,     // 128-bit, SSE4.1 for non-temporal loads
+    ISA_AVX2,    // 256-bit
+    ISA_AVX512,  // 512-bit, AVX-512F and AVX-512BW
+};
+typedef enum isa_e isa_t;
+
+inline const char *isa_name(isa_t isa)
+{
+    switch (isa)
+    {
+        case ISA_SSE: return "sse";
+        case ISA_AVX2: return "avx2";
+        case ISA_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+inline isa_t isa_parse(const std::string &name)
+{
+    if (name == "scalar") return ISA_SCALAR;
+    if (name == "sse") return ISA_SSE;
+    if (name == "avx2") return ISA_AVX2;
+    if (name == "avx512") return ISA_AVX512;
+
+    XBT_ERROR("unknown instruction set: %s (expected scalar, sse, avx2 or avx512)", name.c_str());
+    throw std::runtime_error("unknown instruction set.");
+}
+
+inline bool isa_supported(isa_t isa)
+{
+    __builtin_cpu_init();
+
+    switch (isa)
+    {
+        case ISA_SSE: return __builtin_cpu_supports("sse4.1");
+        case ISA_AVX2: return __builtin_cpu_supports("avx2");
+        case ISA_AVX512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        default: return true;
+    }
+}
+
+// Widest variant the running CPU supports.
+inline isa_t isa_best()
+{
+    if (isa_supported(ISA_AVX512)) return ISA_AVX512;
+    if (isa_supported(ISA_AVX2)) return ISA_AVX2;
+    if (isa_supported(ISA_SSE)) return ISA_SSE;
+    return ISA_SCALAR;
+}
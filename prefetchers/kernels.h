@@ -0,0 +1,491 @@
+// Templated write and read kernels.
+//
+// One kernel per combination of
+//   - width: bytes per access, 1 or 8 (general purpose registers), 16 (SSE),
+//     32 (AVX2) or 64 (AVX-512),
+//   - temporality: regular loads and stores, non-temporal ones (movnt*
+//     stores, movntdqa loads), or regular accesses followed by a clflush of
+//     the line (evicted as soon as it has been used),
+//   - stride: bytes between two accesses, 0 for contiguous, e.g. 64 for one
+//     access per cache line or 4096 for one per page,
+//   - unroll: accesses issued per loop iteration, with one accumulator each
+//     for reads.
+// Write kernels fill the accessed bytes with a 64-bit value; read kernels sum
+// the accessed words so the loads cannot be optimized away. Each vector width
+// has its own loop compiled with __attribute__((target(...))), as in isa.h,
+// so no -march flag is needed. Buffers must be aligned to the width.
+//
+// kernel_matrix() instantiates every combination; the scalar non-temporal
+// loads are plain loads (there is no non-temporal load before SSE4.1) and
+// 1-byte non-temporal stores do not exist, so that width has no
+// non-temporal kernel.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <immintrin.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "isa.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+enum kernel_temporality_e
+{
+    KERNEL_TEMPORAL,
+    KERNEL_NON_TEMPORAL,
+    KERNEL_FLUSH,        // Regular access, then clflush of the line
+};
+typedef enum kernel_temporality_e kernel_temporality_t;
+
+typedef void (*kernel_write_t)(char *dest, size_t size, uint64_t value);
+typedef uint64_t (*kernel_read_t)(const char *src, size_t size);
+
+struct kernel_config_s
+{
+    size_t width;
+    kernel_temporality_t temporality;
+    size_t stride; // 0 for contiguous
+    int unroll;
+};
+typedef struct kernel_config_s kernel_config_t;
+
+// What one kernel call over a buffer moves: the bytes its accesses load or
+// store, and the bytes of the cache lines they land in (the traffic between
+// memory and the caches).
+struct kernel_bytes_s
+{
+    size_t touched;
+    size_t lines;
+};
+typedef struct kernel_bytes_s kernel_bytes_t;
+
+struct kernel_entry_s
+{
+    kernel_config_t config;
+    isa_t isa;
+    kernel_write_t write;
+    kernel_read_t read;
+};
+typedef struct kernel_entry_s kernel_entry_t;
+
+inline const char *kernel_temporality_name(kernel_temporality_t temporality)
+{
+    switch (temporality)
+    {
+        case KERNEL_NON_TEMPORAL: return "nt";
+        case KERNEL_FLUSH: return "flush";
+        default: return "temporal";
+    }
+}
+
+inline kernel_temporality_t kernel_temporality_parse(const std::string &name)
+{
+    if (name == "temporal") return KERNEL_TEMPORAL;
+    if (name == "nt") return KERNEL_NON_TEMPORAL;
+    if (name == "flush") return KERNEL_FLUSH;
+
+    XBT_ERROR("unknown temporality: %s (expected temporal, nt or flush)", name.c_str());
+    throw std::runtime_error("unknown temporality.");
+}
+
+// "w<width>-<temporality>-s<stride>-u<unroll>", e.g. "w64-nt-s0-u4".
+inline std::string kernel_config_str(const kernel_config_t &config)
+{
+    std::ostringstream oss;
+    oss << "w" << config.width << "-" << kernel_temporality_name(config.temporality)
+        << "-s" << config.stride << "-u" << config.unroll;
+    return oss.str();
+}
+
+inline kernel_config_t kernel_config_parse(const std::string &name)
+{
+    char temporality[16];
+    kernel_config_t config;
+    if (sscanf(name.c_str(), "w%zu-%15[a-z]-s%zu-u%d", &config.width, temporality, &config.stride, &config.unroll) != 4)
+    {
+        XBT_ERROR("invalid kernel: %s (expected w<width>-<temporality>-s<stride>-u<unroll>)", name.c_str());
+        throw std::runtime_error("invalid kernel.");
+    }
+    config.temporality = kernel_temporality_parse(temporality);
+    return config;
+}
+
+inline bool kernel_config_equal(const kernel_config_t &a, const kernel_config_t &b)
+{
+    return a.width == b.width && a.temporality == b.temporality && a.stride == b.stride && a.unroll == b.unroll;
+}
+
+// Mirrors the loops below: contiguous kernels touch every byte (the tail
+// included); strided ones issue whole groups of `unroll` accesses of `width`
+// bytes, `stride` apart, and skip what is left. Buffers are line aligned.
+inline kernel_bytes_t kernel_bytes_get(const kernel_config_t &config, size_t size)
+{
+    if (config.stride == 0)
+        return {size, (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE};
+
+    size_t unroll = std::max(config.unroll, 1);
+    size_t group_span = (unroll - 1) * config.stride + config.width;
+    if (size < group_span)
+        return {0, 0};
+
+    size_t accesses = ((size - group_span) / (unroll * config.stride) + 1) * unroll;
+    size_t span = (accesses - 1) * config.stride + config.width;
+    size_t lines = config.stride >= CACHE_LINE_SIZE
+        ? accesses * ((config.width + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE
+        : (span + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    return {accesses * config.width, lines};
+}
+
+// Flushes the line of an access once the kernel is done with it: after every
+// access when they are a line or more apart, after the last access of each
+// line when they are contiguous.
+template <kernel_temporality_t Temporality, size_t Width, size_t Stride>
+inline void kernel_evict(const char *p)
+{
+    if constexpr (Temporality == KERNEL_FLUSH)
+    {
+        if constexpr ((Stride ? Stride : Width) >= CACHE_LINE_SIZE)
+            _mm_clflush(p);
+        else if (((uintptr_t)p + Width) % CACHE_LINE_SIZE == 0)
+            _mm_clflush(p);
+    }
+}
+
+// Bytes left after the last full contiguous access.
+inline void kernel_write_tail(char *dest, size_t from, size_t size, uint64_t value)
+{
+    for (size_t i = from; i < size; i++)
+        dest[i] = (char)value;
+}
+
+inline uint64_t kernel_read_tail(const char *src, size_t from, size_t size)
+{
+    uint64_t sum = 0;
+    for (size_t i = from; i < size; i++)
+        sum += (unsigned char)src[i];
+    return sum;
+}
+
+// General purpose registers, Word is uint8_t or uint64_t.
+template <typename Word, kernel_temporality_t Temporality, size_t Stride, int Unroll>
+inline void kernel_write_scalar(char *dest, size_t size, uint64_t value)
+{
+    static_assert(Temporality != KERNEL_NON_TEMPORAL || sizeof(Word) == 8, "no 1-byte non-temporal store");
+    constexpr size_t step = Stride ? Stride : sizeof(Word);
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + sizeof(Word) <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            char *p = dest + i + u * step;
+            if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+                _mm_stream_si64((long long *)p, (long long)value);
+            else
+                *(volatile Word *)p = (Word)value;
+            kernel_evict<Temporality, sizeof(Word), Stride>(p);
+        }
+    }
+
+    if constexpr (Stride == 0)
+        kernel_write_tail(dest, i, size, value);
+    if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+        _mm_sfence();
+}
+
+template <typename Word, kernel_temporality_t Temporality, size_t Stride, int Unroll>
+inline uint64_t kernel_read_scalar(const char *src, size_t size)
+{
+    constexpr size_t step = Stride ? Stride : sizeof(Word);
+    uint64_t sum[Unroll] = {};
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + sizeof(Word) <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            const char *p = src + i + u * step;
+            sum[u] += *(const volatile Word *)p;
+            kernel_evict<Temporality, sizeof(Word), Stride>(p);
+        }
+    }
+
+    uint64_t total = Stride == 0 ? kernel_read_tail(src, i, size) : 0;
+    for (int u = 0; u < Unroll; u++)
+        total += sum[u];
+    return total;
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("sse4.1")))
+inline void kernel_write_sse(char *dest, size_t size, uint64_t value)
+{
+    constexpr size_t step = Stride ? Stride : 16;
+    const __m128i v = _mm_set1_epi64x((long long)value);
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 16 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            char *p = dest + i + u * step;
+            if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+                _mm_stream_si128((__m128i *)p, v);
+            else
+                _mm_store_si128((__m128i *)p, v);
+            kernel_evict<Temporality, 16, Stride>(p);
+        }
+    }
+
+    if constexpr (Stride == 0)
+        kernel_write_tail(dest, i, size, value);
+    if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+        _mm_sfence();
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("sse4.1")))
+inline uint64_t kernel_read_sse(const char *src, size_t size)
+{
+    constexpr size_t step = Stride ? Stride : 16;
+    __m128i sum[Unroll];
+    for (int u = 0; u < Unroll; u++)
+        sum[u] = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 16 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            const char *p = src + i + u * step;
+            __m128i v = Temporality == KERNEL_NON_TEMPORAL ? _mm_stream_load_si128((__m128i *)p) : _mm_load_si128((const __m128i *)p);
+            sum[u] = _mm_add_epi64(sum[u], v);
+            kernel_evict<Temporality, 16, Stride>(p);
+        }
+    }
+
+    uint64_t total = Stride == 0 ? kernel_read_tail(src, i, size) : 0;
+    for (int u = 0; u < Unroll; u++)
+    {
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, sum[u]);
+        total += lanes[0] + lanes[1];
+    }
+    return total;
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("avx2")))
+inline void kernel_write_avx2(char *dest, size_t size, uint64_t value)
+{
+    constexpr size_t step = Stride ? Stride : 32;
+    const __m256i v = _mm256_set1_epi64x((long long)value);
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 32 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            char *p = dest + i + u * step;
+            if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+                _mm256_stream_si256((__m256i *)p, v);
+            else
+                _mm256_store_si256((__m256i *)p, v);
+            kernel_evict<Temporality, 32, Stride>(p);
+        }
+    }
+
+    if constexpr (Stride == 0)
+        kernel_write_tail(dest, i, size, value);
+    if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+        _mm_sfence();
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("avx2")))
+inline uint64_t kernel_read_avx2(const char *src, size_t size)
+{
+    constexpr size_t step = Stride ? Stride : 32;
+    __m256i sum[Unroll];
+    for (int u = 0; u < Unroll; u++)
+        sum[u] = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 32 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            const char *p = src + i + u * step;
+            __m256i v = Temporality == KERNEL_NON_TEMPORAL ? _mm256_stream_load_si256((const __m256i *)p) : _mm256_load_si256((const __m256i *)p);
+            sum[u] = _mm256_add_epi64(sum[u], v);
+            kernel_evict<Temporality, 32, Stride>(p);
+        }
+    }
+
+    uint64_t total = Stride == 0 ? kernel_read_tail(src, i, size) : 0;
+    for (int u = 0; u < Unroll; u++)
+    {
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, sum[u]);
+        total += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return total;
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("avx512f,avx512bw")))
+inline void kernel_write_avx512(char *dest, size_t size, uint64_t value)
+{
+    constexpr size_t step = Stride ? Stride : 64;
+    const __m512i v = _mm512_set1_epi64((long long)value);
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 64 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            char *p = dest + i + u * step;
+            if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+                _mm512_stream_si512((__m512i *)p, v);
+            else
+                _mm512_store_si512((__m512i *)p, v);
+            kernel_evict<Temporality, 64, Stride>(p);
+        }
+    }
+
+    if constexpr (Stride == 0)
+        kernel_write_tail(dest, i, size, value);
+    if constexpr (Temporality == KERNEL_NON_TEMPORAL)
+        _mm_sfence();
+}
+
+template <kernel_temporality_t Temporality, size_t Stride, int Unroll>
+__attribute__((target("avx512f,avx512bw")))
+inline uint64_t kernel_read_avx512(const char *src, size_t size)
+{
+    constexpr size_t step = Stride ? Stride : 64;
+    __m512i sum[Unroll];
+    for (int u = 0; u < Unroll; u++)
+        sum[u] = _mm512_setzero_si512();
+    size_t i = 0;
+
+    for (; i + (Unroll - 1) * step + 64 <= size; i += Unroll * step)
+    {
+#pragma GCC unroll 8
+        for (int u = 0; u < Unroll; u++)
+        {
+            const char *p = src + i + u * step;
+            __m512i v = Temporality == KERNEL_NON_TEMPORAL ? _mm512_stream_load_si512((void *)p) : _mm512_load_si512((const void *)p);
+            sum[u] = _mm512_add_epi64(sum[u], v);
+            kernel_evict<Temporality, 64, Stride>(p);
+        }
+    }
+
+    // Stored lane by lane: GCC 12 warns on _mm512_reduce_add_epi64 here.
+    uint64_t total = Stride == 0 ? kernel_read_tail(src, i, size) : 0;
+    for (int u = 0; u < Unroll; u++)
+    {
+        uint64_t lanes[8];
+        _mm512_storeu_si512((void *)lanes, sum[u]);
+        for (int lane = 0; lane < 8; lane++)
+            total += lanes[lane];
+    }
+    return total;
+}
+
+template <size_t Width, kernel_temporality_t Temporality, size_t Stride, int Unroll>
+inline void kernel_write(char *dest, size_t size, uint64_t value)
+{
+    if constexpr (Width == 1) kernel_write_scalar<uint8_t, Temporality, Stride, Unroll>(dest, size, value);
+    else if constexpr (Width == 8) kernel_write_scalar<uint64_t, Temporality, Stride, Unroll>(dest, size, value);
+    else if constexpr (Width == 16) kernel_write_sse<Temporality, Stride, Unroll>(dest, size, value);
+    else if constexpr (Width == 32) kernel_write_avx2<Temporality, Stride, Unroll>(dest, size, value);
+    else kernel_write_avx512<Temporality, Stride, Unroll>(dest, size, value);
+}
+
+template <size_t Width, kernel_temporality_t Temporality, size_t Stride, int Unroll>
+inline uint64_t kernel_read(const char *src, size_t size)
+{
+    if constexpr (Width == 1) return kernel_read_scalar<uint8_t, Temporality, Stride, Unroll>(src, size);
+    else if constexpr (Width == 8) return kernel_read_scalar<uint64_t, Temporality, Stride, Unroll>(src, size);
+    else if constexpr (Width == 16) return kernel_read_sse<Temporality, Stride, Unroll>(src, size);
+    else if constexpr (Width == 32) return kernel_read_avx2<Temporality, Stride, Unroll>(src, size);
+    else return kernel_read_avx512<Temporality, Stride, Unroll>(src, size);
+}
+
+template <size_t Width, kernel_temporality_t Temporality, size_t Stride, int Unroll>
+inline kernel_entry_t kernel_entry()
+{
+    isa_t isa = Width == 16 ? ISA_SSE : Width == 32 ? ISA_AVX2 : Width == 64 ? ISA_AVX512 : ISA_SCALAR;
+    return {{Width, Temporality, Stride, Unroll}, isa,
+        kernel_write<Width, Temporality, Stride, Unroll>, kernel_read<Width, Temporality, Stride, Unroll>};
+}
+
+template <size_t Width, kernel_temporality_t Temporality, size_t Stride>
+inline void kernel_matrix_add(std::vector<kernel_entry_t> &matrix)
+{
+    matrix.push_back(kernel_entry<Width, Temporality, Stride, 1>());
+    matrix.push_back(kernel_entry<Width, Temporality, Stride, 2>());
+    matrix.push_back(kernel_entry<Width, Temporality, Stride, 4>());
+    matrix.push_back(kernel_entry<Width, Temporality, Stride, 8>());
+}
+
+template <size_t Width, kernel_temporality_t Temporality>
+inline void kernel_matrix_add(std::vector<kernel_entry_t> &matrix)
+{
+    kernel_matrix_add<Width, Temporality, 0>(matrix);
+    kernel_matrix_add<Width, Temporality, 64>(matrix);
+    kernel_matrix_add<Width, Temporality, 4096>(matrix);
+}
+
+template <size_t Width>
+inline void kernel_matrix_add(std::vector<kernel_entry_t> &matrix)
+{
+    kernel_matrix_add<Width, KERNEL_TEMPORAL>(matrix);
+    if constexpr (Width > 1)
+        kernel_matrix_add<Width, KERNEL_NON_TEMPORAL>(matrix);
+    kernel_matrix_add<Width, KERNEL_FLUSH>(matrix);
+}
+
+// Every instantiated kernel: widths 1, 8, 16, 32 and 64, the three
+// temporalities, strides 0 (contiguous), 64 and 4096, unroll 1, 2, 4 and 8.
+inline const std::vector<kernel_entry_t> &kernel_matrix()
+{
+    static std::vector<kernel_entry_t> matrix;
+    if (matrix.empty())
+    {
+        kernel_matrix_add<1>(matrix);
+        kernel_matrix_add<8>(matrix);
+        kernel_matrix_add<16>(matrix);
+        kernel_matrix_add<32>(matrix);
+        kernel_matrix_add<64>(matrix);
+    }
+    return matrix;
+}
+
+// The kernel of a configuration; throws if it is not instantiated.
+inline const kernel_entry_t &kernel_get(const kernel_config_t &config)
+{
+    for (const kernel_entry_t &entry : kernel_matrix())
+        if (kernel_config_equal(entry.config, config))
+            return entry;
+
+    XBT_ERROR("kernel %s is not instantiated (see kernel_matrix in kernels.h)", kernel_config_str(config).c_str());
+    throw std::runtime_error("kernel not instantiated.");
+}
@@ -0,0 +1,98 @@
+// Dependent-load (pointer-chasing) latency kernel.
+//
+// Each visited element stores the address of the next one, in a random cyclic
+// order, so every load depends on the previous one. Hardware prefetchers cannot
+// predict the next address and the measured time is the true load-to-use
+// latency of the memory holding the buffer, with prefetchers left enabled.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <time.h>
+
+#include "common.h"
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Links one element per stride (a cache line or a page) of the buffer into a
+// single random cycle and returns its first element. With strides larger than
+// a cache line the element sits at a random line inside its stride, so the
+// chain does not hammer the same cache sets. Over 4 KiB pages a cache-line
+// chase also takes a DTLB miss on nearly every load; back the buffer with huge
+// pages to measure the memory alone. Returns NULL if the buffer holds fewer
+// than two elements.
+inline char *latency_chase_build(char *buffer, size_t size, size_t stride, uint64_t seed=42)
+{
+    size_t elements = size / stride;
+    if (elements < 2)
+        return NULL;
+
+    std::mt19937_64 rng(seed);
+    std::vector<size_t> order(elements);
+    std::vector<size_t> offset(elements, 0);
+    for (size_t i = 0; i < elements; i++)
+        order[i] = i;
+
+    if (stride > CACHE_LINE_SIZE)
+    {
+        std::uniform_int_distribution<size_t> dist(0, stride / CACHE_LINE_SIZE - 1);
+        for (size_t i = 0; i < elements; i++)
+            offset[i] = dist(rng) * CACHE_LINE_SIZE;
+    }
+
+    // Sattolo's algorithm yields a single cycle through all elements.
+    for (size_t i = elements - 1; i > 0; i--)
+    {
+        std::uniform_int_distribution<size_t> dist(0, i - 1);
+        std::swap(order[i], order[dist(rng)]);
+    }
+
+    for (size_t i = 0; i < elements; i++)
+    {
+        size_t from = order[i];
+        size_t to = order[(i + 1) % elements];
+        *(char **)(buffer + from * stride + offset[from]) = buffer + to * stride + offset[to];
+    }
+
+    return buffer + order[0] * stride + offset[order[0]];
+}
+
+// Follows the chain for the given number of loads and returns the average
+// nanoseconds per load. The chain head is advanced so consecutive calls keep
+// walking instead of replaying the (now cached) first elements.
+inline double latency_chase_run_ns(char **head, size_t accesses)
+{
+    char *p = *head;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    // Volatile loads keep the compiler from dropping the chain.
+    for (size_t i = 0; i < accesses; i++)
+        p = *(char *volatile *)p;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+    *head = p;
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed_ns / accesses;
+}
+
+// Cache-line strided chase over the buffer: builds the chain, walks it once to
+// fault in pages and TLB entries, then times the given number of loads.
+inline double latency_chase_ns(char *buffer, size_t size, size_t accesses)
+{
+    char *head = latency_chase_build(buffer, size, CACHE_LINE_SIZE);
+    if (!head)
+        return 0.0;
+
+    latency_chase_run_ns(&head, size / CACHE_LINE_SIZE);
+
+    return latency_chase_run_ns(&head, accesses);
+}
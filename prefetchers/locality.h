@@ -0,0 +1,159 @@
+// Continuous thread-locality monitor.
+//
+// thread_get_locality_from_os takes one snapshot after the read phase, so a
+// migration in the middle of a phase goes unnoticed. A locality monitor is
+// sampled once per chunk from the hot loop: rdtscp returns the TSC together
+// with TSC_AUX, where Linux keeps (node << 12) | cpu of the current CPU, so a
+// sample costs one instruction. Without rdtscp it falls back to getcpu(2).
+// Every core or NUMA node change is kept with its time, the time between
+// samples is charged to the node the thread was on, and context switches and
+// kernel migrations are counted over the phase (getrusage and
+// /proc/thread-self/sched, read only at start and stop).
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <x86intrin.h> // For __rdtscp
+#include <cpuid.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <cstdint>
+
+#include "common.h"
+#include "timing.h"
+#include "placement.h"
+
+struct locality_change_s
+{
+    uint64_t ticks; // timer_ticks() of the first sample on the new CPU
+    int cpu;
+    int numa_id;
+};
+typedef struct locality_change_s locality_change_t;
+
+struct locality_monitor_s
+{
+    uint64_t start_ticks;
+    uint64_t last_ticks;
+    int cpu;
+    int numa_id;
+    std::vector<locality_change_t> changes; // The first entry is where the phase started
+    std::map<int, uint64_t> ticks_per_node;
+    size_t core_changes;
+    size_t node_changes;
+    long voluntary_context_switches;
+    long involuntary_context_switches;
+    long core_migrations;                   // Kernel count, including moves between two samples
+};
+typedef struct locality_monitor_s locality_monitor_t;
+
+inline bool locality_rdtscp_supported()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+        return false;
+    return edx & (1u << 27);
+}
+
+// Current CPU and NUMA node of the calling thread, with the time they were read.
+inline uint64_t locality_where(int *cpu, int *numa_id)
+{
+    static const bool use_rdtscp = locality_rdtscp_supported() && tsc_invariant();
+
+    if (use_rdtscp)
+    {
+        unsigned int aux;
+        uint64_t ticks = __rdtscp(&aux);
+        *cpu = aux & 0xFFF;
+        *numa_id = aux >> 12;
+        return ticks;
+    }
+
+    unsigned int getcpu_cpu = 0, getcpu_node = 0;
+    syscall(SYS_getcpu, &getcpu_cpu, &getcpu_node, NULL);
+    *cpu = getcpu_cpu;
+    *numa_id = getcpu_node;
+    return timer_ticks();
+}
+
+inline void locality_monitor_start(locality_monitor_t &monitor)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    monitor.voluntary_context_switches = -usage.ru_nvcsw;
+    monitor.involuntary_context_switches = -usage.ru_nivcsw;
+    monitor.core_migrations = -sched_migrations_get();
+    monitor.changes.clear();
+    monitor.ticks_per_node.clear();
+    monitor.core_changes = 0;
+    monitor.node_changes = 0;
+
+    monitor.start_ticks = monitor.last_ticks = locality_where(&monitor.cpu, &monitor.numa_id);
+    monitor.changes.push_back({monitor.start_ticks, monitor.cpu, monitor.numa_id});
+}
+
+// Called once per chunk. The time since the previous sample is charged to
+// the node seen then: a change is only noticed at the next sample.
+inline void locality_monitor_sample(locality_monitor_t &monitor)
+{
+    int cpu, numa_id;
+    uint64_t ticks = locality_where(&cpu, &numa_id);
+
+    monitor.ticks_per_node[monitor.numa_id] += ticks - monitor.last_ticks;
+    monitor.last_ticks = ticks;
+
+    if (cpu != monitor.cpu)
+    {
+        monitor.core_changes++;
+        if (numa_id != monitor.numa_id)
+            monitor.node_changes++;
+
+        monitor.cpu = cpu;
+        monitor.numa_id = numa_id;
+        monitor.changes.push_back({ticks, cpu, numa_id});
+    }
+}
+
+inline void locality_monitor_stop(locality_monitor_t &monitor)
+{
+    locality_monitor_sample(monitor);
+
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    monitor.voluntary_context_switches += usage.ru_nvcsw;
+    monitor.involuntary_context_switches += usage.ru_nivcsw;
+    monitor.core_migrations += sched_migrations_get();
+}
+
+// "{cpus: [t_us@cpu/node, ...], core_changes: N, node_changes: N, vcs: N,
+// ics: N, mig: N, time_us: {node: us, ...}}", times from the phase start.
+inline std::string locality_monitor_str(const locality_monitor_t &monitor)
+{
+    double ticks_per_ns = timer_ticks_per_ns();
+    std::ostringstream oss;
+
+    oss << "{cpus: [";
+    for (size_t i = 0; i < monitor.changes.size(); i++)
+    {
+        const locality_change_t &change = monitor.changes[i];
+        oss << (i ? ", " : "") << (uint64_t)((change.ticks - monitor.start_ticks) / ticks_per_ns / 1e3)
+            << "@" << change.cpu << "/" << change.numa_id;
+    }
+
+    std::map<int, uint64_t> time_us;
+    for (const auto &entry : monitor.ticks_per_node)
+        time_us[entry.first] = (uint64_t)(entry.second / ticks_per_ns / 1e3);
+
+    oss << "], core_changes: " << monitor.core_changes << ", node_changes: " << monitor.node_changes
+        << ", vcs: " << monitor.voluntary_context_switches << ", ics: " << monitor.involuntary_context_switches
+        << ", mig: " << monitor.core_migrations << ", time_us: " << node_map_str(time_us) << "}";
+
+    return oss.str();
+}
@@ -0,0 +1,158 @@
+// Memory placement policies matching the nflows mapper.
+//
+// nflows templates choose placement with mapper_mem_policy_type (`default` or
+// `bind`) and mapper_mem_bind_numa_node_ids. These policies let the
+// benchmarks reproduce that placement through hwloc instead of an external
+// `numactl --membind`:
+//
+//   default            no policy, pages land where they are first written
+//   bind:N[,N...]      hwloc BIND to the listed nodes (templates 1L, 1R)
+//   interleave:N[,N..] pages spread round-robin over the listed nodes
+//   first-touch:X      pages are faulted in from a CPU of node X before the
+//                      benchmark runs, as when a producer task on node X
+//                      wrote the data that a consumer elsewhere reads
+//                      (templates 2N, 2A, 4N, 4A with the default policy)
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <hwloc.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+#include "common.h"
+
+enum mem_policy_type_e
+{
+    MEM_POLICY_DEFAULT,
+    MEM_POLICY_BIND,
+    MEM_POLICY_INTERLEAVE,
+    MEM_POLICY_FIRST_TOUCH,
+};
+typedef enum mem_policy_type_e mem_policy_type_t;
+
+struct mem_policy_s
+{
+    mem_policy_type_t type;
+    std::vector<int> numa_ids; // Bind/interleave nodes, or the single first-touch node
+};
+typedef struct mem_policy_s mem_policy_t;
+
+inline const char *mem_policy_type_name(mem_policy_type_t type)
+{
+    switch (type)
+    {
+        case MEM_POLICY_BIND: return "bind";
+        case MEM_POLICY_INTERLEAVE: return "interleave";
+        case MEM_POLICY_FIRST_TOUCH: return "first-touch";
+        default: return "default";
+    }
+}
+
+inline mem_policy_t mem_policy_bind(int numa_id)
+{
+    mem_policy_t policy = {MEM_POLICY_BIND, {numa_id}};
+    return policy;
+}
+
+// Parses "default", "bind:0,1", "interleave:0,1,2,3" or "first-touch:2".
+inline mem_policy_t mem_policy_parse(const std::string &spec)
+{
+    mem_policy_t policy = {MEM_POLICY_DEFAULT, {}};
+
+    size_t colon = spec.find(':');
+    std::string name = spec.substr(0, colon);
+
+    if (name == "bind") policy.type = MEM_POLICY_BIND;
+    else if (name == "interleave") policy.type = MEM_POLICY_INTERLEAVE;
+    else if (name == "first-touch") policy.type = MEM_POLICY_FIRST_TOUCH;
+    else if (name != "default")
+    {
+        XBT_ERROR("unknown memory policy: %s (expected default, bind, interleave or first-touch)", name.c_str());
+        throw std::runtime_error("unknown memory policy.");
+    }
+
+    if (colon != std::string::npos)
+    {
+        std::istringstream iss(spec.substr(colon + 1));
+        std::string token;
+        while (std::getline(iss, token, ','))
+            policy.numa_ids.push_back(atoi(token.c_str()));
+    }
+
+    bool needs_nodes = policy.type != MEM_POLICY_DEFAULT;
+    if (needs_nodes == policy.numa_ids.empty() ||
+        (policy.type == MEM_POLICY_FIRST_TOUCH && policy.numa_ids.size() != 1))
+    {
+        XBT_ERROR("invalid node list for memory policy: %s", spec.c_str());
+        throw std::runtime_error("invalid node list for memory policy.");
+    }
+
+    return policy;
+}
+
+inline std::string mem_policy_str(const mem_policy_t &policy)
+{
+    std::string str = mem_policy_type_name(policy.type);
+    if (!policy.numa_ids.empty())
+        str += ":" + join(policy.numa_ids);
+    return str;
+}
+
+// Faults in every page of the area from a CPU of numa_id, then restores the
+// binding of the calling thread.
+inline int mem_policy_first_touch(hwloc_topology_t topology, char *address, size_t size, int numa_id)
+{
+    hwloc_obj_t node = hwloc_get_numanode_obj_by_os_index(topology, numa_id);
+    if (!node || hwloc_bitmap_iszero(node->cpuset))
+    {
+        XBT_ERROR("NUMA node %d has no CPU to first-touch from.", numa_id);
+        errno = EINVAL;
+        return -1;
+    }
+
+    hwloc_cpuset_t previous = hwloc_bitmap_alloc();
+    hwloc_get_cpubind(topology, previous, HWLOC_CPUBIND_THREAD);
+
+    int status = hwloc_set_cpubind(topology, node->cpuset, HWLOC_CPUBIND_THREAD);
+    if (status == 0)
+    {
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE_4K)
+            ((volatile char *)address)[offset] = 0;
+    }
+    else
+        XBT_ERROR("unable to bind to NUMA node %d for first touch. errno: %d, error: %s", numa_id, errno, strerror(errno));
+
+    hwloc_set_cpubind(topology, previous, HWLOC_CPUBIND_THREAD);
+    hwloc_bitmap_free(previous);
+
+    return status;
+}
+
+// Applies the policy to an area that has not been touched yet. Returns 0 on
+// success, -1 with errno set otherwise.
+inline int mem_policy_apply(hwloc_topology_t topology, char *address, size_t size, const mem_policy_t &policy)
+{
+    if (policy.type == MEM_POLICY_DEFAULT)
+        return 0;
+
+    if (policy.type == MEM_POLICY_FIRST_TOUCH)
+        return mem_policy_first_touch(topology, address, size, policy.numa_ids[0]);
+
+    hwloc_nodeset_t nodeset = hwloc_bitmap_alloc();
+    for (int numa_id : policy.numa_ids)
+        hwloc_bitmap_set(nodeset, numa_id);
+
+    hwloc_membind_policy_t membind = policy.type == MEM_POLICY_INTERLEAVE ? HWLOC_MEMBIND_INTERLEAVE : HWLOC_MEMBIND_BIND;
+    int status = hwloc_set_area_membind(topology, address, size, nodeset, membind, HWLOC_MEMBIND_BYNODESET);
+    hwloc_bitmap_free(nodeset);
+
+    if (status != 0)
+        XBT_ERROR("unable to apply memory policy %s. errno: %d, error: %s", mem_policy_str(policy).c_str(), errno, strerror(errno));
+
+    return status;
+}
@@ -0,0 +1,148 @@
+// Explicit page migration of a buffer to another NUMA node.
+//
+// Two kernel paths move the pages of an area:
+//   - move_pages(2) with a target node per page, issued `batch_pages` pages
+//     per call,
+//   - mbind(2) with MPOL_MF_MOVE (through hwloc_set_area_membind with
+//     HWLOC_MEMBIND_MIGRATE), issued `batch_pages` pages' worth of the range
+//     per call; it also rebinds the range, so later faults land on the target,
+//     and with HWLOC_MEMBIND_STRICT fails instead of leaving pages behind.
+// With several threads the page range is split into contiguous slices, one
+// per thread, each bound to one of the given PUs; with one PU or none the
+// calling thread does the work. For huge pages the list holds one address
+// per huge page, which moves the whole page.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <hwloc.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+
+#define MIGRATE_MPOL_MF_MOVE (1 << 1) // From <numaif.h>
+
+enum migrate_method_e
+{
+    MIGRATE_MOVE_PAGES,
+    MIGRATE_MBIND,
+};
+typedef enum migrate_method_e migrate_method_t;
+
+struct migrate_request_s
+{
+    migrate_method_t method;
+    size_t page_size;   // 4 KiB, or the huge page size of the buffer
+    size_t batch_pages; // Pages per system call
+    std::vector<int> pus; // One thread per PU
+};
+typedef struct migrate_request_s migrate_request_t;
+
+inline const char *migrate_method_name(migrate_method_t method)
+{
+    return method == MIGRATE_MBIND ? "mbind" : "move_pages";
+}
+
+inline migrate_method_t migrate_method_parse(const std::string &name)
+{
+    if (name == "move_pages") return MIGRATE_MOVE_PAGES;
+    if (name == "mbind") return MIGRATE_MBIND;
+
+    XBT_ERROR("unknown migration method: %s (expected move_pages or mbind)", name.c_str());
+    throw std::runtime_error("unknown migration method.");
+}
+
+// Moves pages [first, first + count) of the area. Returns the number of
+// pages the kernel could not move, or -1 if a call failed.
+inline long migrate_slice(hwloc_topology_t topology, char *address, size_t first, size_t count, int numa_id, const migrate_request_t &request)
+{
+    size_t batch = std::max(request.batch_pages, (size_t)1);
+    long failed = 0;
+
+    if (request.method == MIGRATE_MBIND)
+    {
+        hwloc_nodeset_t nodeset = numa_nodeset_get(topology, numa_id);
+        for (size_t page = first; page < first + count; page += batch)
+        {
+            size_t pages = std::min(batch, first + count - page);
+            if (hwloc_set_area_membind(topology, address + page * request.page_size, pages * request.page_size, nodeset,
+                    HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_BYNODESET | HWLOC_MEMBIND_MIGRATE | HWLOC_MEMBIND_STRICT) != 0)
+            {
+                XBT_ERROR("mbind failed to migrate to NUMA node %d. errno: %d, error: %s", numa_id, errno, strerror(errno));
+                failed = -1;
+                break;
+            }
+        }
+        hwloc_bitmap_free(nodeset);
+        return failed;
+    }
+
+    std::vector<void *> pages(std::min(batch, count));
+    std::vector<int> nodes(pages.size(), numa_id);
+    std::vector<int> status(pages.size());
+
+    for (size_t page = first; page < first + count; page += batch)
+    {
+        size_t pages_count = std::min(batch, first + count - page);
+        for (size_t i = 0; i < pages_count; i++)
+            pages[i] = address + (page + i) * request.page_size;
+
+        // A positive return is the number of pages left behind.
+        long status_count = syscall(__NR_move_pages, 0, pages_count, pages.data(), nodes.data(), status.data(), MIGRATE_MPOL_MF_MOVE);
+        if (status_count < 0)
+        {
+            XBT_ERROR("move_pages failed to migrate to NUMA node %d. errno: %d, error: %s", numa_id, errno, strerror(errno));
+            return -1;
+        }
+        for (size_t i = 0; i < pages_count; i++)
+            if (status[i] != numa_id)
+                failed++;
+    }
+
+    return failed;
+}
+
+// Moves the size bytes at address (page aligned) to numa_id. Returns the
+// number of pages left on another node, or -1 on error (a failed call or a
+// thread that could not be bound to its PU).
+inline long migrate_run(hwloc_topology_t topology, char *address, size_t size, int numa_id, const migrate_request_t &request)
+{
+    size_t pages = (size + request.page_size - 1) / request.page_size;
+    size_t threads = std::max(request.pus.size(), (size_t)1);
+    size_t slice = (pages + threads - 1) / threads;
+
+    // A single slice runs on the calling thread, wherever it is bound.
+    if (threads == 1)
+        return migrate_slice(topology, address, 0, pages, numa_id, request);
+
+    std::atomic<long> failed(0);
+    std::atomic<bool> error(false);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads && t * slice < pages; t++)
+    {
+        workers.emplace_back([&, t]() {
+            if (!thread_try_bind_to_pu(topology, request.pus[t]))
+                error.store(true);
+            long slice_failed = migrate_slice(topology, address, t * slice, std::min(slice, pages - t * slice), numa_id, request);
+            if (slice_failed < 0)
+                error.store(true);
+            else
+                failed.fetch_add(slice_failed);
+        });
+    }
+
+    for (std::thread &worker : workers)
+        worker.join();
+
+    return error.load() ? -1 : failed.load();
+}
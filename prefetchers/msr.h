@@ -0,0 +1,215 @@
+// In-process control of the Intel prefetchers through MSR 0x1A4.
+//
+// Does from the benchmark what set_prefetchers.sh does with msr-tools: bits 0
+// to 3 of MSR 0x1A4 disable the L2 hardware (HW), L2 adjacent line (ADJ), DCU
+// streamer (DCU) and DCU IP prefetchers of a core. The original value of every
+// touched CPU is saved first and restored at exit and on fatal signals, so an
+// interrupted sweep does not leave the node with prefetchers disabled.
+//
+// The backend only decides which file holds the MSRs of a CPU: /dev/cpu/N/msr
+// (needs root and the msr module), or one regular file per CPU in a
+// directory, so the sweep and restore logic can be exercised without root or
+// Intel hardware. Both are accessed with pread/pwrite at offset 0x1A4.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+
+#define MSR_MISC_FEATURE_CONTROL 0x1A4
+#define MSR_PREFETCH_MASK 0xFULL
+
+struct msr_backend_s
+{
+    std::string name;
+    std::string path_format; // printf format with the CPU number
+    bool stand_in;           // Files are created on demand and read as 0 when empty
+};
+typedef struct msr_backend_s msr_backend_t;
+
+struct msr_prefetch_s
+{
+    msr_backend_t backend;
+    std::vector<int> cpus;
+    std::vector<int> fds;
+    std::vector<uint64_t> saved; // Value of MSR 0x1A4 on each CPU before the first change
+};
+typedef struct msr_prefetch_s msr_prefetch_t;
+
+inline msr_backend_t msr_backend_dev()
+{
+    return {"dev", "/dev/cpu/%d/msr", false};
+}
+
+inline msr_backend_t msr_backend_file(const std::string &dir)
+{
+    return {"file", dir + "/cpu%d.msr", true};
+}
+
+// "dev" or "file:DIR".
+inline msr_backend_t msr_backend_parse(const std::string &spec)
+{
+    if (spec == "dev")
+        return msr_backend_dev();
+    if (spec.compare(0, 5, "file:") == 0 && spec.size() > 5)
+        return msr_backend_file(spec.substr(5));
+
+    XBT_ERROR("unknown MSR backend: %s (expected dev or file:DIR)", spec.c_str());
+    throw std::runtime_error("unknown MSR backend.");
+}
+
+inline int msr_read(const msr_prefetch_t &msr, size_t index, uint64_t *value)
+{
+    ssize_t bytes = pread(msr.fds[index], value, sizeof(*value), MSR_MISC_FEATURE_CONTROL);
+    if (bytes == 0 && msr.backend.stand_in)
+    {
+        *value = 0;
+        return 0;
+    }
+    return bytes == sizeof(*value) ? 0 : -1;
+}
+
+inline int msr_write(const msr_prefetch_t &msr, size_t index, uint64_t value)
+{
+    return pwrite(msr.fds[index], &value, sizeof(value), MSR_MISC_FEATURE_CONTROL) == sizeof(value) ? 0 : -1;
+}
+
+// The state restored by the exit and signal handlers. Only one sweep can be
+// active at a time.
+static msr_prefetch_t *msr_prefetch_active = NULL;
+
+// Async-signal-safe: only pwrite on descriptors opened beforehand.
+inline void msr_prefetch_restore_raw(msr_prefetch_t *msr)
+{
+    for (size_t i = 0; i < msr->fds.size(); i++)
+        msr_write(*msr, i, msr->saved[i]);
+}
+
+inline void msr_prefetch_restore_atexit()
+{
+    if (msr_prefetch_active)
+        msr_prefetch_restore_raw(msr_prefetch_active);
+}
+
+inline void msr_prefetch_restore_signal(int signum)
+{
+    if (msr_prefetch_active)
+        msr_prefetch_restore_raw(msr_prefetch_active);
+
+    // Die from the same signal with the default action.
+    signal(signum, SIG_DFL);
+    raise(signum);
+}
+
+// Opens the MSR files of the given CPUs, saves their current value and
+// installs the restore handlers. Returns false (with every file closed) if
+// any CPU cannot be read.
+inline bool msr_prefetch_open(msr_prefetch_t &msr, const msr_backend_t &backend, const std::vector<int> &cpus)
+{
+    msr.backend = backend;
+    msr.cpus = cpus;
+
+    for (int cpu : cpus)
+    {
+        char path[4096];
+        snprintf(path, sizeof(path), backend.path_format.c_str(), cpu);
+
+        int fd = open(path, backend.stand_in ? O_RDWR | O_CREAT : O_RDWR, 0644);
+        uint64_t value = 0;
+        if (fd != -1)
+        {
+            msr.fds.push_back(fd);
+            if (msr_read(msr, msr.fds.size() - 1, &value) == 0)
+            {
+                msr.saved.push_back(value);
+                continue;
+            }
+        }
+
+        XBT_ERROR("unable to access MSR 0x%X of CPU %d through %s. errno: %d, error: %s",
+            MSR_MISC_FEATURE_CONTROL, cpu, path, errno, strerror(errno));
+        for (int open_fd : msr.fds)
+            close(open_fd);
+        msr.fds.clear();
+        msr.saved.clear();
+        return false;
+    }
+
+    msr_prefetch_active = &msr;
+
+    static bool handlers_installed = false;
+    if (!handlers_installed)
+    {
+        atexit(msr_prefetch_restore_atexit);
+        for (int signum : {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGABRT, SIGSEGV, SIGBUS, SIGFPE, SIGILL})
+            signal(signum, msr_prefetch_restore_signal);
+        handlers_installed = true;
+    }
+
+    return true;
+}
+
+// Sets the four prefetcher disable bits of every CPU, keeping the other bits
+// of the saved value.
+inline bool msr_prefetch_set(msr_prefetch_t &msr, uint64_t mask)
+{
+    for (size_t i = 0; i < msr.fds.size(); i++)
+    {
+        uint64_t value = (msr.saved[i] & ~MSR_PREFETCH_MASK) | (mask & MSR_PREFETCH_MASK);
+        if (msr_write(msr, i, value) != 0)
+        {
+            XBT_ERROR("unable to write MSR 0x%X of CPU %d. errno: %d, error: %s", MSR_MISC_FEATURE_CONTROL, msr.cpus[i], errno, strerror(errno));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Current prefetcher bits of every CPU (-1 where the read fails).
+inline std::vector<long> msr_prefetch_get(const msr_prefetch_t &msr)
+{
+    std::vector<long> masks;
+    for (size_t i = 0; i < msr.fds.size(); i++)
+    {
+        uint64_t value;
+        masks.push_back(msr_read(msr, i, &value) == 0 ? (long)(value & MSR_PREFETCH_MASK) : -1);
+    }
+    return masks;
+}
+
+// Restores the saved values and closes the files.
+inline void msr_prefetch_close(msr_prefetch_t &msr)
+{
+    msr_prefetch_restore_raw(&msr);
+
+    for (int fd : msr.fds)
+        close(fd);
+    msr.fds.clear();
+
+    if (msr_prefetch_active == &msr)
+        msr_prefetch_active = NULL;
+}
+
+// Names of the prefetchers left enabled by a mask, e.g. "HW+DCU" or "none".
+inline std::string msr_prefetch_mask_str(uint64_t mask)
+{
+    static const char *names[] = {"HW", "ADJ", "DCU", "IP"};
+    std::vector<std::string> enabled;
+
+    for (int bit = 0; bit < 4; bit++)
+        if (!(mask & (1ULL << bit)))
+            enabled.push_back(names[bit]);
+
+    return enabled.empty() ? "none" : join(enabled, "+");
+}
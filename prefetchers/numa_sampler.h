@@ -0,0 +1,194 @@
+// Background AutoNUMA sampler.
+//
+// page_placement_get shows where the buffer lives after the write and after
+// the read phase, but not when pages moved in between. While the read phase
+// runs, this sampler thread wakes up every interval, reads the AutoNUMA
+// counters of /proc/vmstat and queries the node of a sparse subset of the
+// buffer's pages. numa_timeline_get then lines the samples up with the
+// per-chunk read timing: each point covers one sampling interval and carries
+// the counter increments, the page placement at its end and the throughput of
+// the chunks started inside it.
+//
+// The counters are system-wide, so other processes' migrations show up too.
+// The sampler sleeps between samples and is not pinned; on a busy node give
+// it a core of its own with taskset.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+
+#include "common.h"
+#include "timing.h"
+#include "placement.h"
+#include "results.h"
+
+#define NUMA_SAMPLER_PAGE_SAMPLE 512
+
+// /proc/vmstat counters followed on the timeline. The last four only exist
+// on kernels built with CONFIG_NUMA_BALANCING and read as 0 otherwise.
+static const char *NUMA_VMSTAT_KEYS[] = {"numa_hit", "numa_miss", "numa_pte_updates", "numa_hint_faults", "numa_hint_faults_local", "numa_pages_migrated"};
+
+struct numa_sample_s
+{
+    uint64_t ticks;                        // timer_ticks() when the sample was taken
+    std::map<std::string, uint64_t> vmstat;
+    std::map<int, size_t> pages_per_node;  // Sampled pages only
+};
+typedef struct numa_sample_s numa_sample_t;
+
+struct numa_sampler_s
+{
+    char *buffer;
+    size_t size;
+    size_t page_sample;
+    std::chrono::microseconds interval;
+    std::atomic<bool> stop;
+    std::thread thread;
+    std::vector<numa_sample_t> samples;
+};
+typedef struct numa_sampler_s numa_sampler_t;
+
+struct numa_timeline_point_s
+{
+    double time_ms;                        // End of the interval, from the first sample
+    std::map<std::string, uint64_t> delta; // Counter increments over the interval
+    std::map<int, size_t> pages_per_node;
+    size_t chunks;                         // Read chunks started in the interval
+    double read_gbps;                      // Their bytes over their time, 0 without chunks
+};
+typedef struct numa_timeline_point_s numa_timeline_point_t;
+
+// The numa_* counters of /proc/vmstat.
+inline std::map<std::string, uint64_t> vmstat_numa_get()
+{
+    std::map<std::string, uint64_t> counters;
+    std::ifstream vmstat("/proc/vmstat");
+    std::string key;
+    uint64_t value;
+
+    while (vmstat >> key >> value)
+        if (key.compare(0, 5, "numa_") == 0)
+            counters[key] = value;
+
+    return counters;
+}
+
+inline numa_sample_t numa_sample_take(char *buffer, size_t size, size_t page_sample)
+{
+    numa_sample_t sample;
+    sample.ticks = timer_ticks();
+    sample.vmstat = vmstat_numa_get();
+    sample.pages_per_node = page_placement_get(buffer, size, page_sample).pages_per_node;
+    return sample;
+}
+
+inline void numa_sampler_run(numa_sampler_t *sampler)
+{
+    while (!sampler->stop.load(std::memory_order_relaxed))
+    {
+        std::this_thread::sleep_for(sampler->interval);
+        sampler->samples.push_back(numa_sample_take(sampler->buffer, sampler->size, sampler->page_sample));
+    }
+}
+
+// Takes the first sample on the calling thread, so the timeline starts
+// before the phase does, and starts sampling every interval_ms.
+inline void numa_sampler_start(numa_sampler_t &sampler, char *buffer, size_t size, double interval_ms, size_t page_sample=NUMA_SAMPLER_PAGE_SAMPLE)
+{
+    sampler.buffer = buffer;
+    sampler.size = size;
+    sampler.page_sample = page_sample;
+    sampler.interval = std::chrono::microseconds((long)(interval_ms * 1e3));
+    sampler.stop = false;
+    sampler.samples.clear();
+    sampler.samples.push_back(numa_sample_take(buffer, size, page_sample));
+    sampler.thread = std::thread(numa_sampler_run, &sampler);
+}
+
+// Stops the thread and takes a last sample, so the timeline covers the end
+// of the phase.
+inline void numa_sampler_stop(numa_sampler_t &sampler)
+{
+    sampler.stop = true;
+    sampler.thread.join();
+    sampler.samples.push_back(numa_sample_take(sampler.buffer, sampler.size, sampler.page_sample));
+}
+
+inline std::vector<numa_timeline_point_t> numa_timeline_get(const std::vector<numa_sample_t> &samples, const chunk_timing_t &timing)
+{
+    std::vector<numa_timeline_point_t> timeline;
+    if (samples.empty())
+        return timeline;
+
+    double ticks_per_ns = timer_ticks_per_ns();
+    size_t chunk = 0;
+
+    for (size_t i = 1; i < samples.size(); i++)
+    {
+        numa_timeline_point_t point;
+        point.time_ms = (samples[i].ticks - samples[0].ticks) / ticks_per_ns / 1e6;
+        point.pages_per_node = samples[i].pages_per_node;
+
+        for (const char *key : NUMA_VMSTAT_KEYS)
+        {
+            auto after = samples[i].vmstat.find(key);
+            auto before = samples[i - 1].vmstat.find(key);
+            if (after != samples[i].vmstat.end() && before != samples[i - 1].vmstat.end())
+                point.delta[key] = after->second - before->second;
+            else
+                point.delta[key] = 0;
+        }
+
+        uint64_t ticks = 0;
+        size_t bytes = 0;
+        point.chunks = 0;
+        for (; chunk < timing.starts.size() && timing.starts[chunk] < samples[i].ticks; chunk++)
+        {
+            ticks += timing.ticks[chunk];
+            bytes += timing.bytes[chunk];
+            point.chunks++;
+        }
+        point.read_gbps = ticks ? bytes / (ticks / ticks_per_ns) : 0.0;
+
+        timeline.push_back(point);
+    }
+
+    return timeline;
+}
+
+inline result_record_t numa_timeline_record(const numa_timeline_point_t &point, int iteration, size_t index)
+{
+    result_record_t record;
+    record_add(record, "iteration", iteration);
+    record_add(record, "sample", index);
+    record_add(record, "time_ms", point.time_ms);
+    record_add(record, "chunks", point.chunks);
+    record_add(record, "read_gbps", point.read_gbps);
+    for (const char *key : NUMA_VMSTAT_KEYS)
+        record_add(record, key, (size_t)point.delta.at(key));
+    record_add(record, "pages", node_map_str(point.pages_per_node));
+
+    return record;
+}
+
+// Prints the timeline of the last sampled phase, one "timeline:" line per
+// point, and appends its points to the results file.
+inline void numa_timeline_log(const numa_sampler_t &sampler, const chunk_timing_t &timing, int iteration, results_file_t &results)
+{
+    std::vector<numa_timeline_point_t> timeline = numa_timeline_get(sampler.samples, timing);
+    for (size_t i = 0; i < timeline.size(); i++)
+    {
+        result_record_t record = numa_timeline_record(timeline[i], iteration, i);
+        XBT_INFO("timeline: %s", record_str(record).c_str());
+        results_write(results, record);
+    }
+}
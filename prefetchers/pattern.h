@@ -0,0 +1,69 @@
+// Generated data pattern for bounded-memory verification.
+//
+// Byte p of the payload is byte (p % 8) of splitmix64(seed + p / 8), so any
+// chunk can be generated or checked on its own from its offset. Writing from
+// a pattern and verifying each chunk after it is read replaces a full-size
+// source buffer, a full-size read-back buffer and a final memcmp: the only
+// large allocation left is the buffer under test.
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#define PATTERN_SEED 0x9E3779B97F4A7C15ULL
+
+inline uint64_t pattern_word(uint64_t index)
+{
+    uint64_t z = PATTERN_SEED + index * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+inline char pattern_byte(size_t position)
+{
+    return (char)(pattern_word(position / 8) >> (8 * (position % 8)));
+}
+
+// Fills dest with the pattern bytes [offset, offset + length).
+inline void pattern_fill(char *dest, size_t offset, size_t length)
+{
+    size_t i = 0;
+
+    for (; i < length && (offset + i) % 8; i++)
+        dest[i] = pattern_byte(offset + i);
+
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word = pattern_word((offset + i) / 8);
+        memcpy(dest + i, &word, sizeof(word));
+    }
+
+    for (; i < length; i++)
+        dest[i] = pattern_byte(offset + i);
+}
+
+// Checks src against the pattern bytes [offset, offset + length). Returns the
+// payload offset of the first mismatching byte, or SIZE_MAX if all match.
+inline size_t pattern_check(const char *src, size_t offset, size_t length)
+{
+    size_t i = 0;
+
+    for (; i < length && (offset + i) % 8; i++)
+        if (src[i] != pattern_byte(offset + i))
+            return offset + i;
+
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word = pattern_word((offset + i) / 8);
+        if (memcmp(src + i, &word, sizeof(word)) != 0)
+            break; // Locate the byte below
+    }
+
+    for (; i < length; i++)
+        if (src[i] != pattern_byte(offset + i))
+            return offset + i;
+
+    return SIZE_MAX;
+}
@@ -0,0 +1,236 @@
+// Hardware performance counters around the write and read phases.
+//
+// Opens perf_event_open counter groups for the calling thread: cycles,
+// instructions, LLC load misses, loads served by local/remote DRAM and L2
+// hardware prefetch requests. The last three are raw encodings, opened only
+// on the CPU model they are defined for. Events the PMU refuses are skipped;
+// when no hardware counter can be opened at all (no PMU access, e.g. inside
+// a container or with a strict perf_event_paranoid) the group falls back to
+// software events so the run still reports page faults and migrations.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cpuid.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+
+struct perf_event_spec_s
+{
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    bool skx_only;   // Raw event encoding, valid on Skylake-SP/Cascade Lake only
+};
+typedef struct perf_event_spec_s perf_event_spec_t;
+
+struct perf_counters_s
+{
+    bool hardware;               // False when only software events could be opened
+    std::vector<int> fds;        // fds[0] is the group leader
+    std::vector<std::string> names;
+};
+typedef struct perf_counters_s perf_counters_t;
+
+struct perf_counter_value_s
+{
+    std::string name;
+    uint64_t value;
+    bool counted;    // False if the group never ran on the PMU; value is then 0
+};
+typedef struct perf_counter_value_s perf_counter_value_t;
+
+#define PERF_CACHE_CONFIG(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+static const perf_event_spec_t perf_hardware_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, false},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, false},
+    {"llc_load_misses", PERF_TYPE_HW_CACHE,
+        PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), false},
+    {"local_dram_loads", PERF_TYPE_RAW, 0x01D3, true},      // MEM_LOAD_L3_MISS_RETIRED.LOCAL_DRAM
+    {"remote_dram_loads", PERF_TYPE_RAW, 0x02D3, true},     // MEM_LOAD_L3_MISS_RETIRED.REMOTE_DRAM
+    {"l2_hw_prefetch_requests", PERF_TYPE_RAW, 0xF824, true}, // L2_RQSTS.ALL_PF
+};
+
+static const perf_event_spec_t perf_software_events[] = {
+    {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, false},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, false},
+    {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false},
+    {"cpu_migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, false},
+};
+
+inline bool cpu_vendor_intel()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+        return false;
+    return ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e; // "GenuineIntel"
+}
+
+// Skylake-SP, Cascade Lake and Cooper Lake are Intel family 6, model 0x55.
+// Raw encodings are model-specific: elsewhere the same codes count other
+// events, or nothing.
+inline bool cpu_model_skx()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!cpu_vendor_intel() || !__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    unsigned int family = (eax >> 8) & 0xF;
+    unsigned int model = ((eax >> 12) & 0xF0) | ((eax >> 4) & 0xF);
+    return family == 6 && model == 0x55;
+}
+
+// Opens one event for the calling thread, retrying in user-space only mode
+// when the kernel refuses to count kernel activity.
+inline int perf_event_open_spec(const perf_event_spec_t &spec, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec.type;
+    attr.config = spec.config;
+    attr.disabled = group_fd == -1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (fd == -1 && (errno == EACCES || errno == EPERM))
+    {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+
+    return fd;
+}
+
+inline void perf_counters_open_group(perf_counters_t &counters, const perf_event_spec_t *specs, size_t count)
+{
+    bool skx = cpu_model_skx();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (specs[i].skx_only && !skx)
+            continue;
+
+        int fd = perf_event_open_spec(specs[i], counters.fds.empty() ? -1 : counters.fds[0]);
+        if (fd == -1)
+        {
+            XBT_DEBUG("perf event %s unavailable. errno: %d, error: %s", specs[i].name, errno, strerror(errno));
+            if (counters.fds.empty())
+                return; // Without a leader the rest of the group cannot be opened.
+            continue;
+        }
+
+        counters.fds.push_back(fd);
+        counters.names.push_back(specs[i].name);
+    }
+}
+
+inline void perf_counters_close(perf_counters_t &counters)
+{
+    // Members first, leader last.
+    for (size_t i = counters.fds.size(); i > 0; i--)
+        close(counters.fds[i - 1]);
+
+    counters.fds.clear();
+    counters.names.clear();
+}
+
+// Opens the counters for the calling thread. Returns an empty group (all
+// operations become no-ops) if even software events are unavailable.
+inline perf_counters_t perf_counters_open()
+{
+    perf_counters_t counters;
+    counters.hardware = true;
+
+    perf_counters_open_group(counters, perf_hardware_events, sizeof(perf_hardware_events) / sizeof(perf_hardware_events[0]));
+
+    if (counters.fds.empty())
+    {
+        XBT_WARN("hardware performance counters unavailable (errno: %d, error: %s), falling back to software events.", errno, strerror(errno));
+        counters.hardware = false;
+        perf_counters_open_group(counters, perf_software_events, sizeof(perf_software_events) / sizeof(perf_software_events[0]));
+    }
+
+    if (counters.fds.empty())
+        XBT_WARN("performance counters unavailable. errno: %d, error: %s", errno, strerror(errno));
+
+    return counters;
+}
+
+inline void perf_counters_start(perf_counters_t &counters)
+{
+    if (counters.fds.empty())
+        return;
+
+    ioctl(counters.fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters.fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+inline void perf_counters_stop(perf_counters_t &counters)
+{
+    if (counters.fds.empty())
+        return;
+
+    ioctl(counters.fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Reads the group, scaling the values if the kernel multiplexed it. A group
+// that was never scheduled on the PMU (time_running of 0) is returned with
+// counted false, so it is not mistaken for a measured 0.
+inline std::vector<perf_counter_value_t> perf_counters_read(const perf_counters_t &counters)
+{
+    std::vector<perf_counter_value_t> values;
+    if (counters.fds.empty())
+        return values;
+
+    // Layout of PERF_FORMAT_GROUP with both time fields: nr, time_enabled, time_running, value[nr].
+    std::vector<uint64_t> data(3 + counters.fds.size());
+    if (read(counters.fds[0], data.data(), data.size() * sizeof(uint64_t)) <= 0)
+    {
+        XBT_WARN("unable to read performance counters. errno: %d, error: %s", errno, strerror(errno));
+        return values;
+    }
+
+    uint64_t time_enabled = data[1];
+    uint64_t time_running = data[2];
+    bool counted = time_running > 0;
+    double scale = (counted && time_running < time_enabled) ? (double)time_enabled / time_running : 1.0;
+
+    for (size_t i = 0; i < data[0] && i < counters.names.size(); i++)
+        values.push_back({counters.names[i], counted ? (uint64_t)(data[3 + i] * scale) : 0, counted});
+
+    return values;
+}
+
+inline std::string perf_counters_str(const std::vector<perf_counter_value_t> &values)
+{
+    std::ostringstream oss;
+
+    oss << "{";
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        oss << values[i].name << ": ";
+        if (values[i].counted)
+            oss << values[i].value;
+        else
+            oss << "not_counted";
+        if (i != values.size() - 1)
+            oss << ", ";
+    }
+    oss << "}";
+
+    return oss.str();
+}
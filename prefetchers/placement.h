@@ -0,0 +1,130 @@
+// Per-page NUMA placement histogram.
+//
+// thread_numa_get only returns the set of nodes an area touches. This probe
+// asks move_pages(2) (with a NULL node list it only queries) where every
+// k-th page of the area lives, in large batches, and keeps the node of each
+// sampled page so two snapshots can be compared page by page.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+
+#define PLACEMENT_BATCH_PAGES 65536
+
+struct page_placement_s
+{
+    size_t page_size;
+    size_t sample_every;               // One page out of sample_every is queried
+    std::vector<int> nodes;            // Node of each sampled page, or -errno (e.g. -ENOENT if not faulted in)
+    std::map<int, size_t> pages_per_node;
+    size_t pages_unplaced;             // Sampled pages without a node
+};
+typedef struct page_placement_s page_placement_t;
+
+struct page_migration_s
+{
+    size_t pages_moved;                // Sampled pages whose node changed
+    std::map<int, long> delta_per_node; // after - before, per node
+};
+typedef struct page_migration_s page_migration_t;
+
+// Queries the node of every sample_every-th page in [address, address + size).
+inline page_placement_t page_placement_get(char *address, size_t size, size_t sample_every=1, size_t page_size=PAGE_SIZE_4K)
+{
+    page_placement_t placement;
+    placement.page_size = page_size;
+    placement.sample_every = sample_every ? sample_every : 1;
+    placement.pages_unplaced = 0;
+
+    uintptr_t first = (uintptr_t)address & ~(uintptr_t)(page_size - 1);
+    size_t pages = ((uintptr_t)address + size - first + page_size - 1) / page_size;
+    size_t samples = (pages + placement.sample_every - 1) / placement.sample_every;
+    placement.nodes.resize(samples);
+
+    std::vector<void *> batch(std::min((size_t)PLACEMENT_BATCH_PAGES, samples));
+    std::vector<int> status(batch.size());
+
+    for (size_t start = 0; start < samples; start += batch.size())
+    {
+        size_t count = std::min(batch.size(), samples - start);
+        for (size_t i = 0; i < count; i++)
+            batch[i] = (void *)(first + (start + i) * placement.sample_every * page_size);
+
+        if (syscall(__NR_move_pages, 0, count, batch.data(), NULL, status.data(), 0) != 0)
+        {
+            XBT_ERROR("move_pages failed to query page placement. errno: %d, error: %s", errno, strerror(errno));
+            throw std::runtime_error("failed to query page placement.");
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            placement.nodes[start + i] = status[i];
+            if (status[i] >= 0)
+                placement.pages_per_node[status[i]]++;
+            else
+                placement.pages_unplaced++;
+        }
+    }
+
+    return placement;
+}
+
+// Compares two snapshots of the same area taken with the same sampling.
+inline page_migration_t page_placement_diff(const page_placement_t &before, const page_placement_t &after)
+{
+    page_migration_t migration;
+    migration.pages_moved = 0;
+
+    size_t samples = std::min(before.nodes.size(), after.nodes.size());
+    for (size_t i = 0; i < samples; i++)
+        if (before.nodes[i] >= 0 && after.nodes[i] >= 0 && before.nodes[i] != after.nodes[i])
+            migration.pages_moved++;
+
+    for (const auto &entry : before.pages_per_node)
+        migration.delta_per_node[entry.first] -= entry.second;
+    for (const auto &entry : after.pages_per_node)
+        migration.delta_per_node[entry.first] += entry.second;
+
+    return migration;
+}
+
+template <typename T>
+inline std::string node_map_str(const std::map<int, T> &map)
+{
+    std::ostringstream oss;
+
+    oss << "{";
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        if (it != map.begin())
+            oss << ", ";
+        oss << it->first << ": " << it->second;
+    }
+    oss << "}";
+
+    return oss.str();
+}
+
+inline std::string page_placement_str(const page_placement_t &placement)
+{
+    return node_map_str(placement.pages_per_node);
+}
+
+inline std::string page_migration_str(const page_migration_t &migration)
+{
+    std::ostringstream oss;
+    oss << "{moved: " << migration.pages_moved << ", delta: " << node_map_str(migration.delta_per_node) << "}";
+    return oss.str();
+}
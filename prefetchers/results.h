@@ -0,0 +1,251 @@
+// In-process repetitions and machine-readable results.
+//
+// Repeating the write and read phases inside one process reuses the buffer,
+// so only the first (warm-up) iterations pay for the allocation and first
+// touch. Each measured iteration becomes a result record: an ordered list of
+// fields printed as the usual "key: value, ..." XBT line and, optionally,
+// appended to a JSON-lines or CSV file. repeat_stats_get summarizes a series
+// after rejecting outliers outside Tukey's fences (1.5 IQR beyond the
+// quartiles).
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include "common.h"
+
+struct repeat_stats_s
+{
+    size_t samples;
+    size_t kept;   // Samples left after outlier rejection
+    double mean;
+    double median;
+    double stddev;
+    double ci95;   // Half-width of the 95% confidence interval of the mean
+};
+typedef struct repeat_stats_s repeat_stats_t;
+
+struct result_field_s
+{
+    std::string key;
+    std::string value;
+    bool text;     // Quoted in JSON and CSV
+    bool invalid;  // inf or nan (e.g. bytes over a zero time), null in JSON
+};
+typedef struct result_field_s result_field_t;
+
+typedef std::vector<result_field_t> result_record_t;
+
+struct results_file_s
+{
+    FILE *file;
+    bool csv;
+    bool header_written;
+};
+typedef struct results_file_s results_file_t;
+
+// Two-sided 97.5% quantile of Student's t for 1..30 degrees of freedom.
+inline double student_t_975(size_t dof)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    if (dof == 0)
+        return 0.0;
+    return dof <= 30 ? table[dof - 1] : 1.960;
+}
+
+inline double sorted_quantile(const std::vector<double> &sorted, double q)
+{
+    double position = q * (sorted.size() - 1);
+    size_t below = (size_t)position;
+    size_t above = std::min(below + 1, sorted.size() - 1);
+    return sorted[below] + (position - below) * (sorted[above] - sorted[below]);
+}
+
+inline repeat_stats_t repeat_stats_get(std::vector<double> samples)
+{
+    repeat_stats_t stats = {samples.size(), 0, 0.0, 0.0, 0.0, 0.0};
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    // Fewer than four samples have no meaningful quartiles; keep them all.
+    std::vector<double> kept = samples;
+    if (samples.size() >= 4)
+    {
+        double q1 = sorted_quantile(samples, 0.25);
+        double q3 = sorted_quantile(samples, 0.75);
+        double low = q1 - 1.5 * (q3 - q1);
+        double high = q3 + 1.5 * (q3 - q1);
+
+        kept.clear();
+        for (double sample : samples)
+            if (sample >= low && sample <= high)
+                kept.push_back(sample);
+    }
+
+    stats.kept = kept.size();
+    stats.median = sorted_quantile(kept, 0.5);
+
+    for (double sample : kept)
+        stats.mean += sample;
+    stats.mean /= kept.size();
+
+    if (kept.size() > 1)
+    {
+        double sum_squares = 0.0;
+        for (double sample : kept)
+            sum_squares += (sample - stats.mean) * (sample - stats.mean);
+        stats.stddev = std::sqrt(sum_squares / (kept.size() - 1));
+        stats.ci95 = student_t_975(kept.size() - 1) * stats.stddev / std::sqrt((double)kept.size());
+    }
+
+    return stats;
+}
+
+inline std::string repeat_stats_str(const repeat_stats_t &stats)
+{
+    char str[256];
+    snprintf(str, sizeof(str), "[samples: %zu, kept: %zu, mean: %f, median: %f, stddev: %f, ci95: %f]",
+        stats.samples, stats.kept, stats.mean, stats.median, stats.stddev, stats.ci95);
+    return str;
+}
+
+inline void record_add(result_record_t &record, const std::string &key, const std::string &value)
+{
+    record.push_back({key, value, true, false});
+}
+
+inline void record_add(result_record_t &record, const std::string &key, const char *value)
+{
+    record.push_back({key, value, true, false});
+}
+
+inline void record_add(result_record_t &record, const std::string &key, double value)
+{
+    char str[64];
+    snprintf(str, sizeof(str), "%f", value);
+    record.push_back({key, str, false, !std::isfinite(value)});
+}
+
+inline void record_add(result_record_t &record, const std::string &key, long value)
+{
+    record.push_back({key, std::to_string(value), false, false});
+}
+
+inline void record_add(result_record_t &record, const std::string &key, int value)
+{
+    record_add(record, key, (long)value);
+}
+
+inline void record_add(result_record_t &record, const std::string &key, size_t value)
+{
+    record.push_back({key, std::to_string(value), false, false});
+}
+
+inline void record_add_locality(result_record_t &record, const thread_locality_t &locality)
+{
+    record_add(record, "numa_id", locality.numa_id);
+    record_add(record, "code_id", locality.core_id);
+    record_add(record, "vcs", locality.voluntary_context_switches);
+    record_add(record, "ics", locality.involuntary_context_switches);
+    record_add(record, "mig", locality.core_migrations);
+}
+
+// "key: value, ..." followed by a period, the format of the XBT result lines.
+inline std::string record_str(const result_record_t &record)
+{
+    std::string str;
+    for (size_t i = 0; i < record.size(); i++)
+    {
+        str += record[i].key + ": " + record[i].value;
+        str += i != record.size() - 1 ? ", " : ".";
+    }
+    return str;
+}
+
+inline std::string results_quote(const std::string &value, bool csv)
+{
+    std::string quoted = "\"";
+    for (char c : value)
+    {
+        if (c == '"')
+            quoted += csv ? "\"\"" : "\\\"";
+        else if (c == '\\' && !csv)
+            quoted += "\\\\";
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Opens path for the records of this run: CSV when it ends in .csv, JSON
+// lines (one object per record) otherwise. An empty path disables the file.
+inline results_file_t results_open(const std::string &path)
+{
+    results_file_t results = {NULL, false, false};
+    if (path.empty())
+        return results;
+
+    results.csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    results.file = fopen(path.c_str(), "w");
+    if (!results.file)
+    {
+        XBT_ERROR("unable to open %s. errno: %d, error: %s", path.c_str(), errno, strerror(errno));
+        throw std::runtime_error("failed to open results file.");
+    }
+
+    return results;
+}
+
+inline void results_write(results_file_t &results, const result_record_t &record)
+{
+    if (!results.file)
+        return;
+
+    if (results.csv)
+    {
+        if (!results.header_written)
+        {
+            for (size_t i = 0; i < record.size(); i++)
+                fprintf(results.file, "%s%s", record[i].key.c_str(), i != record.size() - 1 ? "," : "\n");
+            results.header_written = true;
+        }
+
+        for (size_t i = 0; i < record.size(); i++)
+        {
+            std::string value = record[i].text ? results_quote(record[i].value, true) : record[i].value;
+            fprintf(results.file, "%s%s", value.c_str(), i != record.size() - 1 ? "," : "\n");
+        }
+    }
+    else
+    {
+        fprintf(results.file, "{");
+        for (size_t i = 0; i < record.size(); i++)
+        {
+            // JSON has no inf or nan literal.
+            std::string value = record[i].text ? results_quote(record[i].value, false) : record[i].invalid ? "null" : record[i].value;
+            fprintf(results.file, "\"%s\": %s%s", record[i].key.c_str(), value.c_str(), i != record.size() - 1 ? ", " : "}\n");
+        }
+    }
+
+    fflush(results.file);
+}
+
+inline void results_close(results_file_t &results)
+{
+    if (results.file)
+        fclose(results.file);
+    results.file = NULL;
+}
@@ -0,0 +1,105 @@
+// Double-buffered remote-to-local staging pipeline.
+//
+// A helper thread copies chunk k+1 of a (remote) input into a ring of
+// `depth` local slots while the compute thread checksums chunk k from its
+// slot. Two counters make the ring a single-producer/single-consumer queue:
+// the helper publishes `produced` after a copy and waits while `depth`
+// chunks are unconsumed; the compute thread waits for `produced` and
+// releases the slot with `consumed`. The time either side spends waiting
+// tells which one bounds the pipeline: compute_stall_us is the copy not
+// keeping up, copy_stall_us the ring being full.
+//
+// Include this header after XBT_LOG_NEW_DEFAULT_CATEGORY (see common.h).
+#pragma once
+
+#include <hwloc.h>
+#include <x86intrin.h> // For _mm_pause
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+#include "common.h"
+#include "timing.h"
+#include "checksum.h"
+#include "copy.h"
+
+#define STAGING_YIELD_SPINS 1024
+
+struct staging_result_s
+{
+    double time_us;          // First copy to last checksum
+    double compute_stall_us; // Compute thread waiting for a chunk
+    double copy_stall_us;    // Helper thread waiting for a free slot
+    uint64_t checksum;
+    bool bound;              // The helper thread ran on copy_pu
+};
+typedef struct staging_result_s staging_result_t;
+
+// Spins on a counter; yields now and then so the pipeline still progresses
+// when both threads share one PU. Returns the ticks spent waiting.
+inline uint64_t staging_wait(const std::atomic<size_t> &counter, size_t target)
+{
+    if (counter.load(std::memory_order_acquire) >= target)
+        return 0;
+
+    uint64_t start = timer_ticks();
+    for (size_t spins = 1; counter.load(std::memory_order_acquire) < target; spins++)
+    {
+        _mm_pause();
+        if (spins % STAGING_YIELD_SPINS == 0)
+            std::this_thread::yield();
+    }
+    return timer_ticks() - start;
+}
+
+// ring must hold depth * chunk_bytes and be bound to the compute node. The
+// copy engine must be single-threaded (memcpy, rep-movsb or avx512-nt).
+inline staging_result_t staging_run(hwloc_topology_t topology, const char *input, size_t size, char *ring, size_t chunk_bytes, size_t depth,
+    const copy_engine_t &engine, checksum_kernel_t checksum_read, int copy_pu, int compute_pu)
+{
+    size_t chunks = (size + chunk_bytes - 1) / chunk_bytes;
+    std::atomic<size_t> produced(0), consumed(0);
+    uint64_t copy_stall = 0, compute_stall = 0;
+    bool bound = true;
+
+    thread_bind_to_pu(topology, compute_pu);
+    uint64_t start = timer_ticks();
+
+    std::thread helper([&]() {
+        // Unbound, the helper still copies every chunk so the compute thread
+        // does not wait forever; the caller checks result.bound.
+        bound = thread_try_bind_to_pu(topology, copy_pu);
+        for (size_t k = 0; k < chunks; k++)
+        {
+            if (k >= depth)
+                copy_stall += staging_wait(consumed, k - depth + 1);
+
+            size_t offset = k * chunk_bytes;
+            size_t length = std::min(chunk_bytes, size - offset);
+            copy_run(engine, ring + (k % depth) * chunk_bytes, input + offset, length);
+            produced.store(k + 1, std::memory_order_release);
+        }
+    });
+
+    uint64_t checksum = 0;
+    for (size_t k = 0; k < chunks; k++)
+    {
+        compute_stall += staging_wait(produced, k + 1);
+
+        size_t length = std::min(chunk_bytes, size - k * chunk_bytes);
+        checksum += checksum_read(ring + (k % depth) * chunk_bytes, length);
+        consumed.store(k + 1, std::memory_order_release);
+    }
+
+    uint64_t end = timer_ticks();
+    helper.join();
+
+    staging_result_t result;
+    result.time_us = (end - start) / timer_ticks_per_ns() / 1e3;
+    result.compute_stall_us = compute_stall / timer_ticks_per_ns() / 1e3;
+    result.copy_stall_us = copy_stall / timer_ticks_per_ns() / 1e3;
+    result.checksum = checksum;
+    result.bound = bound;
+    return result;
+}
@@ -0,0 +1,189 @@
+// Per-chunk timing for the write and read phases.
+//
+// A phase is run as a sequence of fixed-size chunks (2 MiB by default) and
+// each chunk is timed with rdtscp, calibrated once against
+// CLOCK_MONOTONIC_RAW. When the CPU has no invariant TSC the chunks are timed
+// with CLOCK_MONOTONIC_RAW directly. The per-chunk distribution shows where a
+// run lost its time (page faults, THP collapses, AutoNUMA migrations), which a
+// single gettimeofday delta around the whole pass hides.
+#pragma once
+
+#include <x86intrin.h> // For __rdtscp
+#include <cpuid.h>
+#include <time.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#define CHUNK_BYTES 2ULL * 1024 * 1024
+
+struct chunk_timing_s
+{
+    std::vector<uint64_t> ticks;  // Elapsed timer ticks per chunk
+    std::vector<size_t> bytes;    // Bytes processed per chunk
+    std::vector<uint64_t> starts; // timer_ticks() when each chunk started
+};
+typedef struct chunk_timing_s chunk_timing_t;
+
+struct chunk_stats_s
+{
+    size_t chunks;
+    double time_us;     // Sum of all chunk times
+    double min_gbps;    // Slowest chunk
+    double median_gbps;
+    double p99_gbps;    // 99% of the chunks ran at least this fast
+    double max_gbps;    // Fastest chunk
+};
+typedef struct chunk_stats_s chunk_stats_t;
+
+inline double timespec_ns(const struct timespec &ts)
+{
+    return (double)ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+inline bool tsc_invariant()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (edx >> 8) & 1;
+}
+
+// TSC ticks per nanosecond, measured once over ~20 ms. Returns 1.0 (ticks
+// are nanoseconds) when the TSC cannot be trusted.
+inline double timer_ticks_per_ns()
+{
+    static double ticks_per_ns = 0.0;
+
+    if (ticks_per_ns == 0.0)
+    {
+        if (!tsc_invariant())
+        {
+            ticks_per_ns = 1.0;
+            return ticks_per_ns;
+        }
+
+        unsigned int aux;
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+        uint64_t tsc_start = __rdtscp(&aux);
+
+        do
+        {
+            clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+        } while (timespec_ns(now) - timespec_ns(start) < 20e6);
+
+        uint64_t tsc_end = __rdtscp(&aux);
+        ticks_per_ns = (tsc_end - tsc_start) / (timespec_ns(now) - timespec_ns(start));
+    }
+
+    return ticks_per_ns;
+}
+
+// Calibrate at startup so the first timed phase (and any counters around it)
+// does not pay for the calibration loop.
+static const double timer_calibration_ticks_per_ns = timer_ticks_per_ns();
+
+inline uint64_t timer_ticks()
+{
+    static const bool use_tsc = tsc_invariant();
+
+    if (use_tsc)
+    {
+        unsigned int aux;
+        return __rdtscp(&aux);
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)timespec_ns(ts);
+}
+
+// Runs kernel(offset, length) over [0, size) in chunks of chunk_bytes and
+// records the time of every call.
+template <typename Kernel>
+inline chunk_timing_t chunk_timed_run(size_t size, size_t chunk_bytes, Kernel kernel)
+{
+    chunk_timing_t timing;
+    timing.ticks.reserve(size / chunk_bytes + 1);
+    timing.bytes.reserve(size / chunk_bytes + 1);
+    timing.starts.reserve(size / chunk_bytes + 1);
+
+    for (size_t offset = 0; offset < size; offset += chunk_bytes)
+    {
+        size_t length = std::min(chunk_bytes, size - offset);
+
+        uint64_t start = timer_ticks();
+        kernel(offset, length);
+        uint64_t end = timer_ticks();
+
+        timing.ticks.push_back(end - start);
+        timing.bytes.push_back(length);
+        timing.starts.push_back(start);
+    }
+
+    return timing;
+}
+
+// Same as above, with untimed before(offset, length) and after(offset, length)
+// calls around every chunk, e.g. to generate a chunk's source data and to
+// verify what was read.
+template <typename Before, typename Kernel, typename After>
+inline chunk_timing_t chunk_timed_run(size_t size, size_t chunk_bytes, Before before, Kernel kernel, After after)
+{
+    chunk_timing_t timing;
+    timing.ticks.reserve(size / chunk_bytes + 1);
+    timing.bytes.reserve(size / chunk_bytes + 1);
+    timing.starts.reserve(size / chunk_bytes + 1);
+
+    for (size_t offset = 0; offset < size; offset += chunk_bytes)
+    {
+        size_t length = std::min(chunk_bytes, size - offset);
+
+        before(offset, length);
+        uint64_t start = timer_ticks();
+        kernel(offset, length);
+        uint64_t end = timer_ticks();
+        after(offset, length);
+
+        timing.ticks.push_back(end - start);
+        timing.bytes.push_back(length);
+        timing.starts.push_back(start);
+    }
+
+    return timing;
+}
+
+inline chunk_stats_t chunk_stats_get(const chunk_timing_t &timing)
+{
+    chunk_stats_t stats = {timing.ticks.size(), 0.0, 0.0, 0.0, 0.0, 0.0};
+    if (stats.chunks == 0)
+        return stats;
+
+    double ticks_per_ns = timer_ticks_per_ns();
+    std::vector<double> gbps(stats.chunks);
+    for (size_t i = 0; i < stats.chunks; i++)
+    {
+        double time_ns = timing.ticks[i] / ticks_per_ns;
+        stats.time_us += time_ns / 1e3;
+        gbps[i] = timing.bytes[i] / std::max(time_ns, 1.0); // bytes per ns == GB/s
+    }
+
+    std::sort(gbps.begin(), gbps.end());
+    stats.min_gbps = gbps.front();
+    stats.median_gbps = gbps[(stats.chunks - 1) / 2];
+    stats.p99_gbps = gbps[(size_t)(0.01 * (stats.chunks - 1))];
+    stats.max_gbps = gbps.back();
+
+    return stats;
+}
+
+inline std::string chunk_stats_str(const chunk_stats_t &stats)
+{
+    char str[256];
+    snprintf(str, sizeof(str), "[chunks: %zu, min: %f, median: %f, p99: %f, max: %f]",
+        stats.chunks, stats.min_gbps, stats.median_gbps, stats.p99_gbps, stats.max_gbps);
+    return str;
+}